@@ -0,0 +1,140 @@
+#include "batch.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SA_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+// Un candidato, misma formula y mismo orden de sumas que SimulatedAnnealing::evaluate_delta
+static inline void evaluate_candidate(const OccupancyGrid& grid, MoveBatch& b, int k) {
+    int dpx = std::abs(b.new_x[k] - b.prev_x[k]);
+    int dpy = std::abs(b.new_y[k] - b.prev_y[k]);
+    int dnx = std::abs(b.new_x[k] - b.next_x[k]);
+    int dny = std::abs(b.new_y[k] - b.next_y[k]);
+
+    b.valid[k] = std::max(dpx, dpy) <= 1 && std::max(dnx, dny) <= 1 && !grid.blocked(b.new_x[k], b.new_y[k]);
+    if (!b.valid[k]) {
+        b.delta[k] = 0.0;
+        return;
+    }
+
+    int opx = b.old_x[k] - b.prev_x[k], opy = b.old_y[k] - b.prev_y[k];
+    int onx = b.old_x[k] - b.next_x[k], ony = b.old_y[k] - b.next_y[k];
+    b.delta[k] = (std::sqrt((double)(dpx * dpx + dpy * dpy)) + std::sqrt((double)(dnx * dnx + dny * dny)))
+               - (std::sqrt((double)(opx * opx + opy * opy)) + std::sqrt((double)(onx * onx + ony * ony)));
+}
+
+void evaluate_move_batch_scalar(const OccupancyGrid& grid, MoveBatch& batch) {
+    for (int k = 0; k < batch.count; ++k) {
+        evaluate_candidate(grid, batch, k);
+    }
+}
+
+#ifdef SA_AVX2_KERNEL
+
+__attribute__((target("avx2")))
+static inline __m256i load8(const int* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+// Ocupacion de 8 celdas (1 = obstaculo) a partir de sus indices con borde
+__attribute__((target("avx2")))
+static inline __m256i gather_blocked(const OccupancyGrid& grid, __m256i idx) {
+    if (grid.mode() == OccupancyGrid::BYTES) {
+        // 4 bytes are read per cell, the storage keeps a word of slack at the end
+        const int* base = reinterpret_cast<const int*>(grid.words());
+        return _mm256_and_si256(_mm256_i32gather_epi32(base, idx, 1), _mm256_set1_epi32(0xFF));
+    }
+
+    const long long* words = reinterpret_cast<const long long*>(grid.words());
+    __m256i word = _mm256_srli_epi32(idx, 6);
+    __m256i bit = _mm256_and_si256(idx, _mm256_set1_epi32(63));
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256i lo = _mm256_and_si256(_mm256_srlv_epi64(
+        _mm256_i32gather_epi64(words, _mm256_castsi256_si128(word), 8),
+        _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bit))), one);
+    __m256i hi = _mm256_and_si256(_mm256_srlv_epi64(
+        _mm256_i32gather_epi64(words, _mm256_extracti128_si256(word, 1), 8),
+        _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bit, 1))), one);
+    __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6); // low half of each 64-bit lane
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(lo, even))),
+        _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(hi, even)), 1);
+}
+
+// Largo de 8 segmentos a partir de dx*dx + dy*dy, en dos mitades de 4 doubles
+__attribute__((target("avx2")))
+static inline void segment_lengths(__m256i d2, __m256d& lo, __m256d& hi) {
+    lo = _mm256_sqrt_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(d2)));
+    hi = _mm256_sqrt_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(d2, 1)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i squared_length(__m256i ax, __m256i ay, __m256i bx, __m256i by) {
+    __m256i dx = _mm256_sub_epi32(ax, bx);
+    __m256i dy = _mm256_sub_epi32(ay, by);
+    return _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+}
+
+//Kernel AVX2, 8 candidatos por iteracion, el resto con la version escalar
+__attribute__((target("avx2")))
+static void evaluate_move_batch_avx2(const OccupancyGrid& grid, MoveBatch& b) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i stride = _mm256_set1_epi32(grid.stride());
+
+    int k = 0;
+    for (; k + 8 <= b.count; k += 8) {
+        __m256i nx = load8(b.new_x + k), ny = load8(b.new_y + k);
+        __m256i ox = load8(b.old_x + k), oy = load8(b.old_y + k);
+        __m256i px = load8(b.prev_x + k), py = load8(b.prev_y + k);
+        __m256i qx = load8(b.next_x + k), qy = load8(b.next_y + k);
+
+        // Chebyshev distance to prev and next must be <= 1
+        __m256i cheb_prev = _mm256_max_epi32(_mm256_abs_epi32(_mm256_sub_epi32(nx, px)),
+                                             _mm256_abs_epi32(_mm256_sub_epi32(ny, py)));
+        __m256i cheb_next = _mm256_max_epi32(_mm256_abs_epi32(_mm256_sub_epi32(nx, qx)),
+                                             _mm256_abs_epi32(_mm256_sub_epi32(ny, qy)));
+        __m256i far = _mm256_or_si256(_mm256_cmpgt_epi32(cheb_prev, one), _mm256_cmpgt_epi32(cheb_next, one));
+
+        __m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(ny, one), stride),
+                                       _mm256_add_epi32(nx, one));
+        __m256i blocked = _mm256_cmpgt_epi32(gather_blocked(grid, idx), _mm256_setzero_si256());
+        __m256i invalid = _mm256_or_si256(far, blocked);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(b.valid + k), _mm256_andnot_si256(invalid, one));
+
+        __m256d pn_lo, pn_hi, nn_lo, nn_hi, po_lo, po_hi, on_lo, on_hi;
+        segment_lengths(squared_length(nx, ny, px, py), pn_lo, pn_hi);
+        segment_lengths(squared_length(nx, ny, qx, qy), nn_lo, nn_hi);
+        segment_lengths(squared_length(ox, oy, px, py), po_lo, po_hi);
+        segment_lengths(squared_length(ox, oy, qx, qy), on_lo, on_hi);
+
+        __m256d delta_lo = _mm256_sub_pd(_mm256_add_pd(pn_lo, nn_lo), _mm256_add_pd(po_lo, on_lo));
+        __m256d delta_hi = _mm256_sub_pd(_mm256_add_pd(pn_hi, nn_hi), _mm256_add_pd(po_hi, on_hi));
+        // invalid lanes are set to 0 like in the scalar version
+        __m256i invalid_lo = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(invalid));
+        __m256i invalid_hi = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(invalid, 1));
+        delta_lo = _mm256_andnot_pd(_mm256_castsi256_pd(invalid_lo), delta_lo);
+        delta_hi = _mm256_andnot_pd(_mm256_castsi256_pd(invalid_hi), delta_hi);
+        _mm256_storeu_pd(b.delta + k, delta_lo);
+        _mm256_storeu_pd(b.delta + k + 4, delta_hi);
+    }
+    for (; k < b.count; ++k) {
+        evaluate_candidate(grid, b, k);
+    }
+}
+
+#endif // SA_AVX2_KERNEL
+
+void evaluate_move_batch(const OccupancyGrid& grid, MoveBatch& batch) {
+#ifdef SA_AVX2_KERNEL
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) {
+        evaluate_move_batch_avx2(grid, batch);
+        return;
+    }
+#endif
+    evaluate_move_batch_scalar(grid, batch);
+}
@@ -0,0 +1,32 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "grid.h"
+
+//Lote de movimientos candidatos en formato structure-of-arrays, cada candidato mueve
+// el punto index del camino de old a new, con prev y next sus vecinos en el camino
+struct MoveBatch {
+    static const int MAX_SIZE = 64;
+
+    int count;
+    int index[MAX_SIZE];
+    int old_x[MAX_SIZE], old_y[MAX_SIZE];
+    int new_x[MAX_SIZE], new_y[MAX_SIZE];
+    int prev_x[MAX_SIZE], prev_y[MAX_SIZE];
+    int next_x[MAX_SIZE], next_y[MAX_SIZE];
+
+    // Filled by evaluate_move_batch
+    int valid[MAX_SIZE];     // 1 if new is free and adjacent to prev and next
+    double delta[MAX_SIZE];  // change of the two segment lengths, only meaningful if valid
+};
+
+//Evalua todos los candidatos del lote: ocupacion de la celda nueva, adyacencia con
+// prev/next y diferencia de largo de los dos segmentos. Usa AVX2 si la CPU lo tiene
+// (se elige en tiempo de ejecucion) y si no la version escalar, ambas dan el mismo resultado.
+// Las celdas nuevas deben estar a lo mas a una celda del grid
+void evaluate_move_batch(const OccupancyGrid& grid, MoveBatch& batch);
+
+//Version escalar, expuesta para compararla con la vectorizada
+void evaluate_move_batch_scalar(const OccupancyGrid& grid, MoveBatch& batch);
+
+#endif // BATCH_H
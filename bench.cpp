@@ -0,0 +1,374 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include "sim_ann.h"
+#include "generator.h"
+#include "pyramid.h"
+#include "chain.h"
+#include "multi_agent.h"
+#include "parallel.h"
+
+// Benchmarks de las operaciones basicas y escalamiento con instancias sinteticas
+// Uso: ./sa_bench [max_size] [bytes|bitmap] [seed]   (make bench usa los valores por defecto)
+
+const double T = 100.0; // same annealing parameters as main
+const double cooling_rate = 0.95;
+const double temp_threshold = 5.0;
+const int MICRO_SIZE = 512;          // grid of the microbenchmarks
+const int MIN_SCALING_SIZE = 64;     // scaling sizes double from here up to max_size
+const double MIN_TIME_S = 0.2;       // each microbenchmark repeats until it takes this long
+const long SCALING_STEPS = 200000;   // Metropolis steps timed per grid size
+const double SCALING_T = 10.0;       // fixed temperature of those steps
+const int SCHEDULE_RUNS = 10;         // runs of each cooling schedule, from the same DFS seed
+const int AGENT_MAP_SIZE = 256;       // blocks map of the multi-agent benchmark
+const int AGENT_TRIP = 40;            // max distance per axis between the start and the end of an agent
+const int REPLAN_SIZE = 512;          // blocks map of the replanning benchmark
+const int REPLAN_UPDATES = 50;        // moves of its obstacle
+const long REPLAN_ITERATIONS = 2000;  // annealing after each move, warm or from a new path
+const std::string output_data = "bench_scaling.csv";
+
+static volatile double sink; // keeps the optimizer from dropping benchmarked calls
+
+//Descarta lo que se escribe en std::cout mientras existe (generate_initial_path imprime)
+class QuietStdout {
+public:
+    QuietStdout() : saved_(std::cout.rdbuf(&null_)) {}
+    ~QuietStdout() { std::cout.rdbuf(saved_); }
+
+private:
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) { return c; }
+    } null_;
+    std::streambuf* saved_;
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Nanosegundos por llamada de f, duplicando las repeticiones hasta MIN_TIME_S
+template <typename F>
+double ns_per_call(F f) {
+    f(); // warm up caches and lazy tables
+    for (long reps = 1;; reps *= 2) {
+        auto start = std::chrono::steady_clock::now();
+        for (long r = 0; r < reps; ++r) f();
+        double elapsed = seconds_since(start);
+        if (elapsed >= MIN_TIME_S) return elapsed * 1e9 / reps;
+    }
+}
+
+void report(const std::string& name, double ns, const std::string& unit) {
+    std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(14) << ns << " ns/" << unit << std::endl;
+}
+
+//Microbenchmarks sobre una instancia aleatoria de MICRO_SIZE x MICRO_SIZE
+void run_microbenchmarks(OccupancyGrid::Mode mode, unsigned seed) {
+    GridInstance instance = generate_instance(INSTANCE_RANDOM, MICRO_SIZE, MICRO_SIZE, seed, mode);
+    std::cout << "Microbenchmarks, random " << MICRO_SIZE << "x" << MICRO_SIZE << std::endl;
+
+    std::vector<std::pair<std::string, double>> results;
+    long iterations = 0;
+    long runs = 0;
+    {
+        QuietStdout quiet;
+        SimulatedAnnealing sa(T, cooling_rate, temp_threshold, instance, std::vector<std::pair<int, int>>());
+        sa.set_random_seed(seed);
+        std::vector<std::pair<int, int>> path = sa.generate_initial_path();
+        sa.seed_method = SEED_DFS;
+        std::vector<std::pair<int, int>> dfs_path = sa.generate_initial_path(); // long seed, gives run() work
+        sa.seed_method = SEED_ASTAR;
+        sa.Current_sol = path;
+
+        std::vector<std::pair<int, int>> positions(4096);
+        std::mt19937 rng(seed);
+        for (auto& pos : positions) pos = {(int)(rng() % MICRO_SIZE), (int)(rng() % MICRO_SIZE)};
+        size_t next = 0;
+
+        results.push_back({"is_valid_position", ns_per_call([&]() {
+            sink = sa.is_valid_position(positions[next++ & 4095]);
+        })});
+        results.push_back({"is_valid_path", ns_per_call([&]() { sink = sa.is_valid_path(path); })});
+        results.push_back({"evaluate_cost", ns_per_call([&]() { sink = sa.evaluate_cost(path); })});
+        results.push_back({"generate_neighbor", ns_per_call([&]() {
+            sink = sa.generate_neighbor(path).size();
+        })});
+        results.push_back({"propose_move", ns_per_call([&]() { sink = sa.propose_move(path).index; })});
+        ChainPath chain;
+        chain.encode(dfs_path);
+        results.push_back({"chain encode (DFS seed)", ns_per_call([&]() {
+            sink = chain.encode(dfs_path);
+        })});
+        results.push_back({"chain point", ns_per_call([&]() {
+            sink = chain.point(next++ % chain.size()).first;
+        })});
+        results.push_back({"chain is_free (DFS seed)", ns_per_call([&]() { sink = chain.is_free(instance.grid); })});
+        results.push_back({"generate_initial_path", ns_per_call([&]() {
+            sink = sa.generate_initial_path().size();
+        })});
+        results.push_back({"run (DFS seed)", ns_per_call([&]() {
+            SimulatedAnnealing run_sa(T, cooling_rate, temp_threshold, instance, dfs_path);
+            run_sa.set_random_seed(seed + runs++);
+            run_sa.run(false);
+            iterations += run_sa.iterations;
+        })});
+    }
+
+    for (const auto& result : results) {
+        report(result.first, result.second, "call");
+    }
+    double iterations_per_run = (double) iterations / runs; // averaged over every run, warm up included
+    report("run iteration", results.back().second / std::max(1.0, iterations_per_run), "iteration");
+}
+
+//Esquemas de enfriamiento (schedule.h) desde el mismo camino DFS de la instancia de los
+// microbenchmarks: costo medio alcanzado, tiempo e iteraciones de cada uno
+void run_schedules(OccupancyGrid::Mode mode, unsigned seed) {
+    GridInstance instance = generate_instance(INSTANCE_RANDOM, MICRO_SIZE, MICRO_SIZE, seed, mode);
+    std::vector<std::pair<int, int>> dfs_path;
+    {
+        QuietStdout quiet;
+        SimulatedAnnealing sa(T, cooling_rate, temp_threshold, instance, std::vector<std::pair<int, int>>());
+        sa.seed_method = SEED_DFS;
+        dfs_path = sa.generate_initial_path();
+    }
+    std::vector<std::pair<std::string, CoolingSchedule>> schedules;
+    CoolingSchedule schedule; // the original
+    schedules.push_back({"original", schedule});
+    schedule.initial_samples = 200;
+    schedule.steps_per_temperature = 100;
+    schedules.push_back({"exponential, estimated", schedule});
+    schedule.kind = COOL_LUNDY_MEES;
+    schedules.push_back({"lundy_mees, estimated", schedule});
+    schedule.kind = COOL_ADAPTIVE;
+    schedules.push_back({"adaptive, estimated", schedule});
+    schedule.max_reheats = 3;
+    schedules.push_back({"adaptive, 3 reheats", schedule});
+
+    std::streamsize precision = std::cout.precision();
+    std::cout << "\nCooling schedules, " << SCHEDULE_RUNS << " runs from the DFS seed ("
+              << dfs_path.size() << " points)" << std::endl;
+    for (const auto& entry : schedules) {
+        double cost = 0.0;
+        double ms = 0.0;
+        long iterations = 0;
+        for (int r = 0; r < SCHEDULE_RUNS; ++r) {
+            SimulatedAnnealing sa(T, cooling_rate, temp_threshold, instance, dfs_path);
+            sa.set_random_seed(seed + r);
+            sa.schedule = entry.second;
+            auto start = std::chrono::steady_clock::now();
+            sa.run(false);
+            ms += seconds_since(start) * 1e3;
+            cost += sa.best_cost;
+            iterations += sa.iterations;
+        }
+        std::cout << "  " << std::left << std::setw(24) << entry.first << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(10) << cost / SCHEDULE_RUNS << " cost"
+                  << std::setw(10) << ms / SCHEDULE_RUNS << " ms"
+                  << std::setw(10) << iterations / SCHEDULE_RUNS << " iterations" << std::endl;
+    }
+    std::cout.precision(precision);
+}
+
+//Varios agentes (multi_agent.h) en un mapa de bloques, con viajes cortos entre celdas libres
+// distintas: conflictos de los caminos iniciales, los que quedan, rondas, grupos y tiempo
+void run_multi_agent(OccupancyGrid::Mode mode, unsigned seed) {
+    GridInstance instance = generate_instance(INSTANCE_BLOCKS, AGENT_MAP_SIZE, AGENT_MAP_SIZE, seed, mode);
+    std::cout << "\nMulti-agent, blocks " << AGENT_MAP_SIZE << "x" << AGENT_MAP_SIZE << ", trips of up to "
+              << AGENT_TRIP << " cells per axis, " << resolve_thread_count(0) << " threads" << std::endl;
+    std::cout << "  agents  conflicts  left  rounds  groups  largest        ms" << std::endl;
+    for (int count = 50; count <= 400; count *= 2) {
+        std::mt19937 rng(seed);
+        std::vector<char> used_start((size_t) AGENT_MAP_SIZE * AGENT_MAP_SIZE, 0);
+        std::vector<char> used_end(used_start.size(), 0);
+        // a free cell not used by another agent, near center if given
+        auto pick = [&](std::vector<char>& used, const std::pair<int, int>* center) {
+            for (;;) {
+                int x = center ? center->first + (int)(rng() % (2 * AGENT_TRIP + 1)) - AGENT_TRIP : (int)(rng() % AGENT_MAP_SIZE);
+                int y = center ? center->second + (int)(rng() % (2 * AGENT_TRIP + 1)) - AGENT_TRIP : (int)(rng() % AGENT_MAP_SIZE);
+                if (!instance.grid.in_bounds(x, y) || instance.grid.blocked(x, y)) continue;
+                if (used[(size_t) y * AGENT_MAP_SIZE + x]) continue;
+                used[(size_t) y * AGENT_MAP_SIZE + x] = 1;
+                return std::make_pair(x, y);
+            }
+        };
+        std::vector<MultiAgentAnnealing::Endpoints> endpoints;
+        for (int k = 0; k < count; ++k) {
+            std::pair<int, int> start = pick(used_start, nullptr);
+            endpoints.push_back({start, pick(used_end, &start)});
+        }
+
+        MultiAgentAnnealing planner(instance);
+        planner.random_seed = seed;
+        auto start = std::chrono::steady_clock::now();
+        planner.plan(endpoints);
+        double ms = seconds_since(start) * 1e3;
+        const MultiAgentRoundStats* first = planner.round_stats.empty() ? nullptr : &planner.round_stats[0];
+        std::cout << std::setw(8) << count << std::setw(11) << (first ? first->conflicts_before : 0)
+                  << std::setw(6) << planner.conflicts << std::setw(8) << planner.round_stats.size()
+                  << std::setw(8) << (first ? first->groups : 0) << std::setw(9) << (first ? first->largest_group : 0)
+                  << std::fixed << std::setprecision(1) << std::setw(10) << ms << std::endl;
+    }
+}
+
+//Replanificacion tras cambios del grid: un obstaculo de 5x5 que cada vez se mueve sobre el mejor
+// camino. update_cells + run_warm sobre el mismo annealer contra construir uno nuevo con el grid
+// cambiado (masks, A* y recocido), los dos con REPLAN_ITERATIONS iteraciones
+void run_replanning(OccupancyGrid::Mode mode, unsigned seed) {
+    GridInstance instance = generate_instance(INSTANCE_BLOCKS, REPLAN_SIZE, REPLAN_SIZE, seed, mode);
+    RunLimits limits;
+    limits.max_iterations = REPLAN_ITERATIONS;
+    CoolingSchedule schedule;
+    schedule.initial_samples = 200; // a warm run restarts from a fraction of the estimated T
+    schedule.steps_per_temperature = 100;
+
+    std::unique_ptr<SimulatedAnnealing> sa;
+    {
+        QuietStdout quiet;
+        sa.reset(new SimulatedAnnealing(T, cooling_rate, temp_threshold, instance));
+    }
+    sa->set_random_seed(seed);
+    sa->schedule = schedule;
+    sa->run_anytime(limits);
+
+    std::mt19937 rng(seed);
+    std::vector<CellChange> obstacle;
+    double update_ms = 0.0, warm_ms = 0.0, warm_cost = 0.0, full_ms = 0.0, full_cost = 0.0;
+    int replans = 0;
+    for (int u = 0; u < REPLAN_UPDATES; ++u) {
+        std::vector<CellChange> changes = obstacle;
+        for (CellChange& change : changes) change.blocked = false; // leaves its last place
+        obstacle.clear();
+        const std::vector<std::pair<int, int>>& best = sa->Best_sol;
+        std::pair<int, int> center = best[1 + rng() % (best.size() - 2)];
+        for (int dy = -2; dy <= 2; ++dy) {
+            for (int dx = -2; dx <= 2; ++dx) {
+                std::pair<int, int> cell(center.first + dx, center.second + dy);
+                if (cell == instance.start || cell == instance.end || !instance.grid.in_bounds(cell.first, cell.second) ||
+                    instance.grid.blocked(cell.first, cell.second)) continue;
+                obstacle.push_back({cell.first, cell.second, true});
+            }
+        }
+        changes.insert(changes.end(), obstacle.begin(), obstacle.end());
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = sa->update_cells(changes);
+        update_ms += seconds_since(start) * 1e3;
+        if (!ok) continue; // the obstacle closed the only way, it moves again next time
+        sa->run_warm(limits);
+        warm_ms += seconds_since(start) * 1e3;
+        warm_cost += sa->best_cost;
+
+        GridInstance changed = instance;
+        changed.grid = sa->grid_instance.grid;
+        changed.masks = NeighborMasks();
+        start = std::chrono::steady_clock::now();
+        {
+            QuietStdout quiet;
+            SimulatedAnnealing fresh(T, cooling_rate, temp_threshold, changed);
+            fresh.set_random_seed(seed + u);
+            fresh.schedule = schedule;
+            fresh.run_anytime(limits);
+            full_cost += fresh.best_cost;
+        }
+        full_ms += seconds_since(start) * 1e3;
+        replans++;
+    }
+
+    std::streamsize precision = std::cout.precision();
+    std::cout << "\nReplanning, blocks " << REPLAN_SIZE << "x" << REPLAN_SIZE << ", a 5x5 obstacle moved onto the best path "
+              << REPLAN_UPDATES << " times (" << replans << " reachable), " << REPLAN_ITERATIONS
+              << " iterations per replan" << std::endl;
+    replans = std::max(1, replans);
+    std::cout << std::fixed << std::setprecision(3)
+              << "  update_cells                " << std::setw(10) << update_ms / REPLAN_UPDATES << " ms" << std::endl
+              << "  update_cells + run_warm     " << std::setw(10) << warm_ms / replans << " ms"
+              << std::setprecision(2) << std::setw(10) << warm_cost / replans << " cost" << std::endl
+              << std::setprecision(3)
+              << "  new annealer + run          " << std::setw(10) << full_ms / replans << " ms"
+              << std::setprecision(2) << std::setw(10) << full_cost / replans << " cost" << std::endl;
+    std::cout.precision(precision);
+}
+
+//Escalamiento: por tipo de instancia y tamano, tiempo de la busqueda inicial, ns por paso
+// de Metropolis a temperatura fija, tiempo de una corrida de grueso a fino (pyramid.h) con su nivel
+// de partida y su costo relativo al camino de A*, y memoria de cada estructura (el camino de A*
+// como vector y como codigo de cadena, chain.h). Se escribe en output_data
+void run_scaling(int max_size, OccupancyGrid::Mode mode, unsigned seed) {
+    std::ofstream out(output_data);
+    const char* header = "kind,size,seed_ms,ns_per_step,pyramid_ms,pyramid_top,pyramid_cost_ratio,path_points,"
+                         "grid_bytes,mask_bytes,search_bytes,path_bytes,chain_bytes,pyramid_bytes";
+    out << header << std::endl;
+    std::cout << "\nScaling (" << (mode == OccupancyGrid::BITMAP ? "bitmap" : "bytes") << " grid), "
+              << SCALING_STEPS << " steps at T = " << SCALING_T << ", saved to " << output_data << std::endl;
+    std::cout << header << std::endl;
+
+    for (int kind = 0; kind < NUM_INSTANCE_KINDS; ++kind) {
+        for (int size = MIN_SCALING_SIZE; size <= max_size; size *= 2) {
+            GridInstance instance = generate_instance((InstanceKind) kind, size, size, seed, mode);
+            instance.masks = NeighborMasks::build(instance.grid);
+
+            SearchContext context;
+            std::vector<std::pair<int, int>> path;
+            auto start = std::chrono::steady_clock::now();
+            find_path(instance.grid, instance.start, instance.end, SEED_ASTAR, context, path);
+            double seed_ms = seconds_since(start) * 1e3;
+
+            SimulatedAnnealing sa(SCALING_T, cooling_rate, temp_threshold, instance, path);
+            sa.set_random_seed(seed);
+            sa.prepare_run(false);
+            start = std::chrono::steady_clock::now();
+            for (long s = 0; s < SCALING_STEPS; ++s) {
+                sa.step();
+            }
+            double ns_per_step = seconds_since(start) * 1e9 / SCALING_STEPS;
+            sink = sa.best_cost;
+
+            GridPyramid pyramid = GridPyramid::build(instance);
+            PyramidAnnealing pyramid_sa(T, cooling_rate, temp_threshold, pyramid);
+            pyramid_sa.random_seed = seed;
+            pyramid_sa.search_context = &context;
+            start = std::chrono::steady_clock::now();
+            pyramid_sa.run(instance.start, instance.end);
+            double pyramid_ms = seconds_since(start) * 1e3;
+            double pyramid_cost_ratio = pyramid_sa.best_cost / sa.evaluate_cost(path);
+            ChainPath chain;
+            chain.encode(path);
+
+            std::ostringstream line;
+            line << instance_kind_name((InstanceKind) kind) << "," << size << ","
+                 << std::fixed << std::setprecision(2) << seed_ms << "," << std::setprecision(1) << ns_per_step << ","
+                 << std::setprecision(2) << pyramid_ms << "," << pyramid_sa.top_level << ","
+                 << std::setprecision(4) << pyramid_cost_ratio << ","
+                 << path.size() << "," << instance.grid.memory_bytes() << "," << instance.masks.memory_bytes() << ","
+                 << context.memory_bytes() << "," << path.capacity() * sizeof(std::pair<int, int>) << ","
+                 << chain.memory_bytes() << ","
+                 << pyramid.memory_bytes();
+            out << line.str() << std::endl;
+            std::cout << line.str() << std::endl;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int max_size = argc > 1 ? std::atoi(argv[1]) : 2048; // 8192 needs about 1 GB with bytes
+    OccupancyGrid::Mode mode = argc > 2 && std::string(argv[2]) == "bitmap" ? OccupancyGrid::BITMAP
+                                                                           : OccupancyGrid::BYTES;
+    unsigned seed = argc > 3 ? (unsigned) std::atoi(argv[3]) : 1;
+
+    run_microbenchmarks(mode, seed);
+    run_schedules(mode, seed);
+    run_multi_agent(mode, seed);
+    run_replanning(mode, seed);
+    run_scaling(max_size, mode, seed);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "chain.h"
+#include <cstdlib>
+
+int ChainPath::direction_of(int dx, int dy) {
+    static const int DIRECTIONS[3][3] = {{7, 0, 4}, {3, -1, 1}, {6, 2, 5}}; // [dy + 1][dx + 1]
+    if (std::abs(dx) > 1 || std::abs(dy) > 1) return -1;
+    return DIRECTIONS[dy + 1][dx + 1];
+}
+
+void ChainPath::clear() {
+    words_.clear();
+    checkpoints_.clear();
+    steps_ = 0;
+    diagonal_steps_ = 0;
+}
+
+void ChainPath::start_at(const std::pair<int, int>& point) {
+    clear();
+    checkpoints_.push_back(point);
+    back_ = point;
+}
+
+void ChainPath::push_back(int direction) {
+    if (steps_ % CODES_PER_WORD == 0) words_.push_back(0);
+    words_.back() |= (uint64_t) direction << (3 * (steps_ % CODES_PER_WORD));
+    back_.first += NEIGHBOR_OFFSETS[direction][0];
+    back_.second += NEIGHBOR_OFFSETS[direction][1];
+    steps_++;
+    if (direction >= 4) diagonal_steps_++;
+    if (steps_ % CHECKPOINT_INTERVAL == 0) checkpoints_.push_back(back_);
+}
+
+bool ChainPath::encode(const std::vector<std::pair<int, int>>& path) {
+    clear();
+    if (path.empty()) return true;
+    start_at(path[0]);
+    words_.reserve((path.size() - 1) / CODES_PER_WORD + 1); // exact unless there are repeated points
+    checkpoints_.reserve((path.size() - 1) / CHECKPOINT_INTERVAL + 1);
+    for (size_t i = 1; i < path.size(); ++i) {
+        int dx = path[i].first - path[i-1].first;
+        int dy = path[i].second - path[i-1].second;
+        if (dx == 0 && dy == 0) continue; // repeated point
+        int d = direction_of(dx, dy);
+        if (d < 0) {
+            clear();
+            return false;
+        }
+        push_back(d);
+    }
+    return true;
+}
+
+void ChainPath::decode(std::vector<std::pair<int, int>>& path) const {
+    path.clear();
+    if (empty()) return;
+    path.reserve(size());
+    std::pair<int, int> p = front();
+    path.push_back(p);
+    for (size_t k = 0; k < steps_; ++k) {
+        int d = direction(k);
+        p.first += NEIGHBOR_OFFSETS[d][0];
+        p.second += NEIGHBOR_OFFSETS[d][1];
+        path.push_back(p);
+    }
+}
+
+std::pair<int, int> ChainPath::point(size_t i) const {
+    std::pair<int, int> p = checkpoints_[i / CHECKPOINT_INTERVAL];
+    for (size_t k = i - i % CHECKPOINT_INTERVAL; k < i; ++k) {
+        int d = direction(k);
+        p.first += NEIGHBOR_OFFSETS[d][0];
+        p.second += NEIGHBOR_OFFSETS[d][1];
+    }
+    return p;
+}
+
+double ChainPath::euclidean_length() const {
+    return (double)(steps_ - diagonal_steps_) + 1.4142135623730951 * (double) diagonal_steps_;
+}
+
+bool ChainPath::is_free(const OccupancyGrid& grid) const {
+    if (empty()) return false;
+    if (!grid.in_bounds(front().first, front().second)) return false;
+    int offsets[8];
+    for (int d = 0; d < 8; ++d) offsets[d] = NEIGHBOR_OFFSETS[d][1] * grid.stride() + NEIGHBOR_OFFSETS[d][0];
+    size_t i = grid.index(front().first, front().second);
+    if (grid.blocked_at(i)) return false;
+    for (size_t k = 0; k < steps_; ++k) {
+        i += offsets[direction(k)];
+        if (grid.blocked_at(i)) return false; // also the border, so the walk never leaves the padded grid
+    }
+    return true;
+}
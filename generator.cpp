@@ -0,0 +1,175 @@
+#include "generator.h"
+#include <random>
+#include <vector>
+#include <algorithm>
+
+const char* instance_kind_name(InstanceKind kind) {
+    switch (kind) {
+        case INSTANCE_RANDOM: return "random";
+        case INSTANCE_MAZE: return "maze";
+        case INSTANCE_CORRIDORS: return "corridors";
+        case INSTANCE_BLOCKS: return "blocks";
+        default: return "unknown";
+    }
+}
+
+namespace {
+
+// Random number in [0, n) from the generator engine
+int uniform(std::mt19937& rng, int n) {
+    return (int)(rng() % (unsigned) n);
+}
+
+//Laberinto perfecto (DFS iterativo) sobre las celdas con x e y pares,
+// las celdas impares son paredes salvo las que se abren entre dos celdas visitadas
+void carve_maze(OccupancyGrid& grid, std::mt19937& rng) {
+    int rows = grid.rows();
+    int cols = grid.cols();
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            grid.set_blocked(x, y, true);
+        }
+    }
+
+    const int DX[4] = {0, 2, 0, -2};
+    const int DY[4] = {-2, 0, 2, 0};
+    std::vector<uint32_t> stack; // x + y * cols, an unvisited even cell is still blocked
+    grid.set_blocked(0, 0, false);
+    stack.push_back(0);
+    while (!stack.empty()) {
+        int x = stack.back() % cols;
+        int y = stack.back() / cols;
+
+        int options[4];
+        int count = 0;
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + DX[d], ny = y + DY[d];
+            if (grid.in_bounds(nx, ny) && grid.blocked(nx, ny)) options[count++] = d;
+        }
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int d = options[uniform(rng, count)];
+        grid.set_blocked(x + DX[d] / 2, y + DY[d] / 2, false);
+        grid.set_blocked(x + DX[d], y + DY[d], false);
+        stack.push_back((uint32_t)(x + DX[d]) + (uint32_t)(y + DY[d]) * cols);
+    }
+    // the end touches an even cell diagonally or orthogonally whatever the parity of rows and cols
+    grid.set_blocked(cols - 1, rows - 1, false);
+}
+
+//Muros horizontales cada 4 filas con una puerta en una posicion aleatoria, los obstaculos
+// van solo en la fila central de cada pasillo asi las otras dos quedan libres
+void carve_corridors(OccupancyGrid& grid, std::mt19937& rng, double density) {
+    for (int y = 3; y < grid.rows() - 1; y += 4) {
+        int door = uniform(rng, grid.cols());
+        for (int x = 0; x < grid.cols(); ++x) {
+            if (x != door) grid.set_blocked(x, y, true);
+        }
+    }
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    for (int y = 1; y < grid.rows() - 1; y += 4) {
+        for (int x = 0; x < grid.cols(); ++x) {
+            if (u(rng) < density) grid.set_blocked(x, y, true);
+        }
+    }
+}
+
+void scatter_obstacles(OccupancyGrid& grid, std::mt19937& rng, double density) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    for (int y = 0; y < grid.rows(); ++y) {
+        for (int x = 0; x < grid.cols(); ++x) {
+            if (u(rng) < density) grid.set_blocked(x, y, true);
+        }
+    }
+}
+
+//Rectangulos de lado entre 1/64 y 1/16 del lado del grid hasta cubrir density del area
+// (contando las superposiciones), sin tapar las esquinas de inicio y final. Son los mapas
+// donde la piramide de pyramid.h conserva los pasos
+void place_blocks(OccupancyGrid& grid, std::mt19937& rng, double density) {
+    int min_side = std::max(1, std::min(grid.rows(), grid.cols()) / 64);
+    int max_side = std::max(min_side, std::min(grid.rows(), grid.cols()) / 16);
+    double target = density * grid.rows() * grid.cols();
+    double covered = 0.0;
+    while (covered < target) {
+        int w = min_side + uniform(rng, max_side - min_side + 1);
+        int h = min_side + uniform(rng, max_side - min_side + 1);
+        int x0 = uniform(rng, grid.cols());
+        int y0 = uniform(rng, grid.rows());
+        if ((x0 < max_side && y0 < max_side) ||
+            (x0 + w > grid.cols() - max_side && y0 + h > grid.rows() - max_side)) continue;
+        for (int y = y0; y < std::min(grid.rows(), y0 + h); ++y) {
+            for (int x = x0; x < std::min(grid.cols(), x0 + w); ++x) {
+                grid.set_blocked(x, y, true);
+            }
+        }
+        covered += (double) w * h;
+    }
+}
+
+//Relleno 8-conexo desde el inicio, true si llega al final
+bool connected(const OccupancyGrid& grid) {
+    size_t goal = grid.index(grid.cols() - 1, grid.rows() - 1);
+    int stride = grid.stride();
+    std::vector<bool> seen(grid.padded_cells(), false);
+    std::vector<size_t> stack(1, grid.index(0, 0));
+    seen[stack[0]] = true;
+    while (!stack.empty()) {
+        size_t cell = stack.back();
+        stack.pop_back();
+        if (cell == goal) return true;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                size_t next = cell + dy * stride + dx;
+                if (!seen[next] && !grid.blocked_at(next)) {
+                    seen[next] = true;
+                    stack.push_back(next);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+//Linea 8-conexa libre de (0, 0) a (cols - 1, rows - 1)
+void carve_line(OccupancyGrid& grid) {
+    int steps = std::max(grid.rows(), grid.cols()) - 1;
+    for (int k = 0; k <= steps; ++k) {
+        int x = steps ? (int)((long long) k * (grid.cols() - 1) / steps) : 0;
+        int y = steps ? (int)((long long) k * (grid.rows() - 1) / steps) : 0;
+        grid.set_blocked(x, y, false);
+    }
+}
+
+} // namespace
+
+GridInstance generate_instance(InstanceKind kind, int rows, int cols, unsigned seed,
+                               OccupancyGrid::Mode mode, double density) {
+    std::mt19937 rng(seed);
+    GridInstance instance;
+    instance.rows = rows;
+    instance.cols = cols;
+    instance.start = {0, 0};
+    instance.end = {cols - 1, rows - 1};
+    instance.grid = OccupancyGrid(rows, cols, mode);
+
+    if (kind == INSTANCE_MAZE) {
+        carve_maze(instance.grid, rng);
+        return instance; // a perfect maze always connects the two corners
+    }
+    if (kind == INSTANCE_CORRIDORS) {
+        carve_corridors(instance.grid, rng, density);
+    } else if (kind == INSTANCE_BLOCKS) {
+        place_blocks(instance.grid, rng, density);
+    } else {
+        scatter_obstacles(instance.grid, rng, density);
+    }
+    instance.grid.set_blocked(0, 0, false);
+    instance.grid.set_blocked(cols - 1, rows - 1, false);
+    if (!connected(instance.grid)) {
+        carve_line(instance.grid);
+    }
+    return instance;
+}
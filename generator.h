@@ -0,0 +1,23 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "sim_ann.h"
+
+//Tipos de instancia sintetica
+enum InstanceKind {
+    INSTANCE_RANDOM,    // independent obstacles with a given density
+    INSTANCE_MAZE,      // perfect maze carved on the even cells, long winding paths
+    INSTANCE_CORRIDORS, // horizontal walls with one door each, a serpentine path
+    INSTANCE_BLOCKS,    // large rectangular obstacles (buildings) with open space between them
+    NUM_INSTANCE_KINDS
+};
+
+const char* instance_kind_name(InstanceKind kind);
+
+//Genera una instancia sintetica reproducible (misma semilla, mismo grid) con el inicio
+// en (0, 0) y el final en (cols - 1, rows - 1). Siempre existe un camino entre ambos,
+// si los obstaculos aleatorios lo cortan se abre una linea recta entre inicio y final
+GridInstance generate_instance(InstanceKind kind, int rows, int cols, unsigned seed,
+                               OccupancyGrid::Mode mode = OccupancyGrid::BYTES, double density = 0.3);
+
+#endif // GENERATOR_H
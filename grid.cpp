@@ -0,0 +1,100 @@
+#include "grid.h"
+#include <cstring>
+
+OccupancyGrid::OccupancyGrid()
+    : rows_(0), cols_(0), mode_(BYTES), bytes_(nullptr), words_(nullptr) {}
+
+OccupancyGrid::OccupancyGrid(int rows, int cols, Mode mode)
+    : rows_(0), cols_(0), mode_(mode), bytes_(nullptr), words_(nullptr) {
+    allocate(rows, cols, mode);
+}
+
+OccupancyGrid::OccupancyGrid(int rows, int cols, const std::vector<unsigned char>& blocked, Mode mode)
+    : rows_(0), cols_(0), mode_(mode), bytes_(nullptr), words_(nullptr) {
+    allocate(rows, cols, mode);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            if (blocked[(size_t)y * cols + x]) {
+                set_blocked(x, y, true);
+            }
+        }
+    }
+}
+
+OccupancyGrid OccupancyGrid::from_bitmap(int rows, int cols, const uint64_t* words,
+                                         std::shared_ptr<const void> owner) {
+    OccupancyGrid grid;
+    grid.rows_ = rows;
+    grid.cols_ = cols;
+    grid.mode_ = BITMAP;
+    grid.words_ = words;
+    grid.owner_ = owner;
+    return grid;
+}
+
+//Reserva el almacenamiento con todas las celdas libres y el borde como obstaculo
+void OccupancyGrid::allocate(int rows, int cols, Mode mode) {
+    rows_ = rows;
+    cols_ = cols;
+    mode_ = mode;
+    owner_.reset();
+
+    size_t cells = padded_cells();
+    size_t words = mode == BITMAP ? (cells + 63) / 64 : (cells + 7) / 8;
+    store_ = std::make_shared<std::vector<uint64_t>>(words + 1, 0); // +1 word of slack for wide loads
+    words_ = store_->data();
+    bytes_ = reinterpret_cast<const unsigned char*>(words_);
+
+    for (int x = -1; x <= cols; ++x) { // border
+        set_blocked(x, -1, true);
+        set_blocked(x, rows, true);
+    }
+    for (int y = 0; y < rows; ++y) {
+        set_blocked(-1, y, true);
+        set_blocked(cols, y, true);
+    }
+}
+
+//Copia el almacenamiento si esta compartido con otra copia del grid o con un archivo mapeado
+void OccupancyGrid::make_unique() {
+    if (store_ && store_.use_count() == 1) return;
+
+    size_t words = (mode_ == BITMAP ? (padded_cells() + 63) / 64 : (padded_cells() + 7) / 8) + 1;
+    std::shared_ptr<std::vector<uint64_t>> copy = std::make_shared<std::vector<uint64_t>>(words, 0);
+    std::memcpy(copy->data(), words_, mode_ == BITMAP ? word_count() * sizeof(uint64_t) : padded_cells());
+    store_ = copy;
+    owner_.reset();
+    words_ = store_->data();
+    bytes_ = reinterpret_cast<const unsigned char*>(words_);
+}
+
+void OccupancyGrid::set_blocked(int x, int y, bool value) {
+    make_unique();
+    size_t i = index(x, y);
+    if (mode_ == BITMAP) {
+        uint64_t bit = (uint64_t)1 << (i & 63);
+        uint64_t& word = (*store_)[i >> 6];
+        word = value ? (word | bit) : (word & ~bit);
+    } else {
+        reinterpret_cast<unsigned char*>(store_->data())[i] = value ? 1 : 0;
+    }
+}
+
+//Misma ocupacion en el otro modo de almacenamiento
+OccupancyGrid OccupancyGrid::to_mode(Mode mode) const {
+    if (mode == mode_) return *this;
+
+    OccupancyGrid converted(rows_, cols_, mode);
+    for (int y = 0; y < rows_; ++y) {
+        for (int x = 0; x < cols_; ++x) {
+            if (blocked(x, y)) {
+                converted.set_blocked(x, y, true);
+            }
+        }
+    }
+    return converted;
+}
+
+size_t OccupancyGrid::memory_bytes() const {
+    return mode_ == BITMAP ? word_count() * sizeof(uint64_t) : padded_cells();
+}
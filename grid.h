@@ -0,0 +1,93 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+//Grid de ocupacion guardado de forma contigua, con un borde de una celda de obstaculos
+// alrededor, asi consultar el vecino de una celda valida no necesita comparar limites.
+// Cada celda ocupa un byte, o un bit en modo BITMAP
+class OccupancyGrid {
+public:
+    enum Mode {
+        BYTES,  // 1 byte per cell, 0 = free, 1 = obstacle
+        BITMAP  // 1 bit per cell, LSB first inside 64-bit words
+    };
+
+    OccupancyGrid();
+    OccupancyGrid(int rows, int cols, Mode mode = BYTES); // all cells free
+    OccupancyGrid(int rows, int cols, const std::vector<unsigned char>& blocked, Mode mode = BYTES);
+
+    // Wraps already padded bitmap words without copying them, owner keeps the memory alive
+    static OccupancyGrid from_bitmap(int rows, int cols, const uint64_t* words,
+                                     std::shared_ptr<const void> owner);
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int stride() const { return cols_ + 2; }
+    Mode mode() const { return mode_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    // Padded index, x and y may be one cell outside the grid (the obstacle border)
+    size_t index(int x, int y) const {
+        return (size_t)(y + 1) * (size_t)(cols_ + 2) + (size_t)(x + 1);
+    }
+    size_t padded_cells() const { return (size_t)(rows_ + 2) * (size_t)(cols_ + 2); }
+
+    bool blocked_at(size_t i) const {
+        return mode_ == BITMAP ? (words_[i >> 6] >> (i & 63)) & 1 : bytes_[i];
+    }
+    bool blocked(int x, int y) const { return blocked_at(index(x, y)); }
+    bool in_bounds(int x, int y) const {
+        return (unsigned)x < (unsigned)cols_ && (unsigned)y < (unsigned)rows_;
+    }
+
+    void set_blocked(int x, int y, bool value); // copies the storage first if it is shared
+    OccupancyGrid to_mode(Mode mode) const;
+
+    const uint64_t* words() const { return words_; } // BITMAP mode storage
+    // Storage identity, copies share it until set_blocked changes one of them (see GridStorageKey)
+    const void* storage() const { return words_; }
+    std::shared_ptr<const void> storage_owner() const {
+        return store_ ? std::shared_ptr<const void>(store_) : owner_;
+    }
+    size_t word_count() const { return mode_ == BITMAP ? (padded_cells() + 63) / 64 : 0; }
+    size_t memory_bytes() const;
+
+private:
+    void allocate(int rows, int cols, Mode mode);
+    void make_unique();
+
+    int rows_;
+    int cols_;
+    Mode mode_;
+    const unsigned char* bytes_;
+    const uint64_t* words_;
+    std::shared_ptr<std::vector<uint64_t>> store_; // owned storage, shared between copies
+    std::shared_ptr<const void> owner_;             // external storage (mapped file)
+};
+
+//Identidad del almacenamiento de un grid, para los datos que se calculan una vez por grid
+// (mascaras de vecinos, tablas de costo). Las copias de un grid comparten su almacenamiento hasta
+// que set_blocked cambia una de ellas, y el weak_ptr evita confundirlo con otro grid creado despues
+// en la misma direccion. Un set_blocked sin copia (grid no compartido) no cambia la identidad,
+// quien lo llama actualiza tambien lo derivado (NeighborMasks::update, update de la politica de costo)
+class GridStorageKey {
+public:
+    GridStorageKey() : data_(nullptr), cells_(0) {}
+    explicit GridStorageKey(const OccupancyGrid& grid)
+        : data_(grid.storage()), cells_(grid.padded_cells()), owner_(grid.storage_owner()) {}
+
+    bool matches(const OccupancyGrid& grid) const {
+        return data_ && data_ == grid.storage() && cells_ == grid.padded_cells() && !owner_.expired();
+    }
+
+private:
+    const void* data_;
+    size_t cells_;
+    std::weak_ptr<const void> owner_;
+};
+
+#endif // GRID_H
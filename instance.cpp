@@ -0,0 +1,247 @@
+#include "instance.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char BINARY_MAGIC[4] = {'S', 'A', 'G', 'B'};
+const uint32_t BINARY_VERSION = 1;
+
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t rows;
+    int32_t cols;
+    int32_t start_x;
+    int32_t start_y;
+    int32_t end_x;
+    int32_t end_y;
+    uint64_t word_count;
+};
+
+static_assert(sizeof(BinaryHeader) == 40, "binary header layout");
+
+// The neighbour loops (search, masks, ChainPath::is_free) stop at the border without bounds checks
+bool border_blocked(const OccupancyGrid& grid) {
+    for (int x = -1; x <= grid.cols(); ++x) {
+        if (!grid.blocked(x, -1) || !grid.blocked(x, grid.rows())) return false;
+    }
+    for (int y = 0; y < grid.rows(); ++y) {
+        if (!grid.blocked(-1, y) || !grid.blocked(grid.cols(), y)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// Parse de las instancias usando coordenadas (x, y) para el grid,
+// las celdas se leen a un arreglo plano y luego se pasan al OccupancyGrid
+bool parse_instance(const std::string& path, GridInstance& grid_instance, OccupancyGrid::Mode mode) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "file error" << path << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> cells; // 1 = obstacle, row major
+    std::string line;
+    int row = 0;
+    int cols = 0;
+    int starts = 0;
+    int ends = 0;
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line == "\r") continue;
+
+        std::stringstream ss(line);
+        std::string cell;
+        int col = 0;
+
+        while (std::getline(ss, cell, ',')) {
+            int value = -1;
+            try {
+                value = std::stoi(cell);
+            } catch (const std::exception&) {
+            }
+            if (value < 0 || value > 3) {
+                std::cerr << "invalid cell value " << cell << " in " << path << std::endl;
+                return false;
+            }
+            cells.push_back(value == 1 ? 1 : 0);
+            if (value == 2) { // start
+                grid_instance.start = {col, row};
+                starts++;
+            } else if (value == 3) { // end
+                grid_instance.end = {col, row};
+                ends++;
+            }
+            col++;
+        }
+
+        if (row == 0) cols = col;
+        if (col != cols) {
+            std::cerr << "row " << row << " has " << col << " cells, expected " << cols << " in " << path << std::endl;
+            return false;
+        }
+        row++;
+    }
+    file.close();
+
+    if (row == 0 || starts != 1 || ends != 1) {
+        std::cerr << "instance needs one start (2) and one end (3): " << path << std::endl;
+        return false;
+    }
+
+    grid_instance.grid = OccupancyGrid(row, cols, cells, mode);
+    grid_instance.rows = row;
+    grid_instance.cols = cols;
+
+    std::cout << "Parsed grid: " << grid_instance.rows << "x" << grid_instance.cols << "\n";
+    std::cout << "Start: (" << grid_instance.start.first << ", " << grid_instance.start.second << ")\n";
+    std::cout << "End: (" << grid_instance.end.first << ", " << grid_instance.end.second << ")\n";
+    return true;
+}
+
+//Escribe la instancia en el formato binario, el grid se convierte a BITMAP si hace falta
+bool write_binary_instance(const std::string& path, const GridInstance& grid_instance) {
+    OccupancyGrid bitmap = grid_instance.grid.to_mode(OccupancyGrid::BITMAP);
+
+    BinaryHeader header;
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.rows = grid_instance.rows;
+    header.cols = grid_instance.cols;
+    header.start_x = grid_instance.start.first;
+    header.start_y = grid_instance.start.second;
+    header.end_x = grid_instance.end.first;
+    header.end_y = grid_instance.end.second;
+    header.word_count = bitmap.word_count();
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "file error" << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(bitmap.words()), header.word_count * sizeof(uint64_t));
+    return file.good();
+}
+
+bool load_binary_instance(const std::string& path, GridInstance& grid_instance) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "file error" << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BinaryHeader)) {
+        std::cerr << "binary instance too short: " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    size_t length = st.st_size;
+    void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid
+    if (data == MAP_FAILED) {
+        std::cerr << "mmap failed: " << path << std::endl;
+        return false;
+    }
+    std::shared_ptr<const void> mapping(data, [length](const void* p) {
+        munmap(const_cast<void*>(p), length);
+    });
+
+    BinaryHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    uint64_t padded = ((uint64_t) header.rows + 2) * ((uint64_t) header.cols + 2);
+    if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 ||
+        header.version != BINARY_VERSION || header.rows <= 0 || header.cols <= 0 ||
+        header.word_count != (padded + 63) / 64 ||
+        sizeof(BinaryHeader) + header.word_count * sizeof(uint64_t) > length) {
+        std::cerr << "invalid binary instance: " << path << std::endl;
+        return false;
+    }
+
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(
+        static_cast<const char*>(data) + sizeof(BinaryHeader));
+    grid_instance.grid = OccupancyGrid::from_bitmap(header.rows, header.cols, words, mapping);
+    if (!border_blocked(grid_instance.grid)) {
+        std::cerr << "invalid binary instance, border not blocked: " << path << std::endl;
+        return false;
+    }
+    grid_instance.rows = header.rows;
+    grid_instance.cols = header.cols;
+    grid_instance.start = {header.start_x, header.start_y};
+    grid_instance.end = {header.end_x, header.end_y};
+
+    const OccupancyGrid& grid = grid_instance.grid;
+    if (!grid.in_bounds(header.start_x, header.start_y) || !grid.in_bounds(header.end_x, header.end_y) ||
+        grid.blocked(header.start_x, header.start_y) || grid.blocked(header.end_x, header.end_y)) {
+        std::cerr << "start or end not in a free cell: " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "Mapped grid: " << grid_instance.rows << "x" << grid_instance.cols << "\n";
+    std::cout << "Start: (" << grid_instance.start.first << ", " << grid_instance.start.second << ")\n";
+    std::cout << "End: (" << grid_instance.end.first << ", " << grid_instance.end.second << ")\n";
+    return true;
+}
+
+bool load_instance(const std::string& path, GridInstance& grid_instance, OccupancyGrid::Mode mode) {
+    char magic[sizeof(BINARY_MAGIC)] = {0};
+    std::ifstream file(path, std::ios::binary);
+    file.read(magic, sizeof(magic));
+    file.close();
+
+    if (std::memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+        return load_binary_instance(path, grid_instance);
+    }
+    return parse_instance(path, grid_instance, mode); // text fallback
+}
+
+InstanceCache::InstanceCache(OccupancyGrid::Mode mode, SeedMethod seed_method, int connectivity)
+    : mode_(mode), seed_method_(seed_method), connectivity_(connectivity) {}
+
+//Camino inicial con la conectividad del Annealer, el costo es el largo euclidiano
+template <class Annealer>
+static void seed_instance(CachedInstance& instance, SeedMethod seed_method, SearchContext& context) {
+    Annealer sa(0.0, 0.0, 0.0, instance.grid_instance, std::vector<std::pair<int, int>>());
+    sa.seed_method = seed_method;
+    sa.search_context = &context;
+    instance.initial_path = sa.generate_initial_path();
+    instance.initial_cost = sa.evaluate_cost(instance.initial_path);
+    instance.seed_ms = sa.telemetry.phase(PHASE_SEED);
+}
+
+//Lee la instancia la primera vez que se pide, junto con el camino inicial y su costo.
+// La carga se hace con el mutex tomado, asi dos hilos no leen el mismo archivo
+std::shared_ptr<const CachedInstance> InstanceCache::get(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = instances_.find(path);
+    if (it != instances_.end()) return it->second;
+
+    std::shared_ptr<CachedInstance> instance;
+    GridInstance grid_instance;
+    if (load_instance(path, grid_instance, mode_)) {
+        grid_instance.masks = NeighborMasks::build(grid_instance.grid); // shared by every run
+        instance = std::make_shared<CachedInstance>();
+        instance->grid_instance = grid_instance;
+
+        if (connectivity_ == 4) {
+            seed_instance<BasicSimulatedAnnealing<EuclideanCost, FourConnected>>(*instance, seed_method_, search_context_);
+        } else {
+            seed_instance<SimulatedAnnealing>(*instance, seed_method_, search_context_);
+        }
+    }
+    instances_[path] = instance;
+    return instance;
+}
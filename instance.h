@@ -0,0 +1,57 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "sim_ann.h"
+
+//Lectura de un archivo .prob, retorna false si el archivo no existe o no es un grid valido
+// (filas de distinto largo, valores fuera de 0-3, sin inicio o sin final)
+bool parse_instance(const std::string& path, GridInstance& grid_instance,
+                    OccupancyGrid::Mode mode = OccupancyGrid::BYTES);
+
+//Formato binario de instancias (little-endian): encabezado de 40 bytes con
+// magic "SAGB", version, rows, cols, start (x, y), end (x, y) y el numero de palabras,
+// seguido del grid como bitmap con borde, el mismo layout que OccupancyGrid en modo BITMAP
+bool write_binary_instance(const std::string& path, const GridInstance& grid_instance);
+
+//Carga un archivo binario con mmap, el grid apunta directo al archivo mapeado sin copiarlo
+bool load_binary_instance(const std::string& path, GridInstance& grid_instance);
+
+//Carga binaria si el archivo empieza con el magic, si no se usa parse_instance.
+// Los archivos binarios quedan siempre en modo BITMAP
+bool load_instance(const std::string& path, GridInstance& grid_instance,
+                   OccupancyGrid::Mode mode = OccupancyGrid::BYTES);
+
+//Instancia leida una sola vez, con lo que no depende de la semilla de cada simulacion
+struct CachedInstance {
+    GridInstance grid_instance;
+    std::vector<std::pair<int, int>> initial_path; // the seed search is deterministic
+    double initial_cost; // euclidean length
+    double seed_ms; // time of the initial path search, 0 without SA_TELEMETRY
+};
+
+//Cache de instancias compartida entre simulaciones e hilos, las entradas son de solo lectura
+class InstanceCache {
+public:
+    // connectivity (4 or 8) of the initial paths, the one of the annealer that will use them
+    explicit InstanceCache(OccupancyGrid::Mode mode = OccupancyGrid::BYTES, SeedMethod seed_method = SEED_ASTAR,
+                           int connectivity = 8);
+
+    // nullptr if the file can't be parsed, the failure is cached too
+    std::shared_ptr<const CachedInstance> get(const std::string& path);
+
+private:
+    OccupancyGrid::Mode mode_;
+    SeedMethod seed_method_;
+    int connectivity_;
+    SearchContext search_context_; // reused for the initial path of every instance
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<const CachedInstance>> instances_;
+};
+
+#endif // INSTANCE_H
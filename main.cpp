@@ -1,23 +1,92 @@
 #include <iostream>
 #include "sim_ann.h"
 #include <fstream>
-#include <sstream>
 #include <vector>
 #include <chrono>
 #include <iomanip>
 #include <string>
 #include <random>
+#include <atomic>
+#include <map>
+#include "parallel.h"
+#include "instance.h"
+#include "tempering.h"
+#include "query.h"
+#include "pyramid.h"
+#include "results.h"
+#include "multi_agent.h"
 
 //Parametros para Simulated Annealing
 const double T = 100.0;
 const double cooling_rate = 0.95; 
 const double temp_threshold = 5.0;
+const int BATCH_SIZE = 1; // >1 evaluates that many candidate moves per step in one batch
+const BatchSelection batch_selection = BATCH_METROPOLIS; // or BATCH_BEST_OF_K
+// Selection weights: shift one point, remove a point, splice a loop, straight shortcut
+const double MOVE_WEIGHTS[NUM_MOVE_TYPES] = {0.7, 0.1, 0.1, 0.1};
+const int SHORTENING_WINDOW = 8; // max points spanned by splice and shortcut moves
+// Cost and connectivity policies (policies.h): EuclideanCost, ManhattanCost, ClearanceCost or
+// TurnPenaltyCost, with EightConnected or FourConnected, also used by the tempering replicas
+typedef BasicSimulatedAnnealing<EuclideanCost, EightConnected> Annealer;
+// Anytime limits of every run, 0 = no limit (only temp_threshold, like before)
+const double TIME_BUDGET_MS = 0.0;
+const long MAX_ITERATIONS = 0;
+const long STAGNATION_WINDOW = 0; // iterations without improving the best path
+// Cooling schedule of every run (schedule.h), the defaults are the original one: T *= cooling_rate
+// after each accepted uphill move, from T down to temp_threshold
+const CoolingKind cooling_kind = COOL_EXPONENTIAL; // COOL_LUNDY_MEES or COOL_ADAPTIVE
+const long STEPS_PER_TEMPERATURE = 0; // >0 cools every that many iterations (adaptive: its window)
+const long LUNDY_TEMPERATURE_STEPS = 1000; // coolings from T to temp_threshold of COOL_LUNDY_MEES
+const int INITIAL_T_SAMPLES = 0; // >0 estimates T and temp_threshold from that many sampled moves
+const double INITIAL_ACCEPTANCE = 0.8; // wanted uphill acceptance at the estimated T (and adaptive start)
+const double FINAL_ACCEPTANCE = 0.01;  // and at the estimated temp_threshold
+const int MAX_REHEATS = 0; // reheats to REHEAT_FRACTION of the initial T, when T reaches temp_threshold
+const long REHEAT_WINDOW = 0; // or after that many iterations without improving the best path, 0 = never
+const double REHEAT_FRACTION = 0.5;
+
+//Parametros para Parallel Tempering, las replicas van del T donde un movimiento cuesta arriba medio se
+// acepta con FINAL_ACCEPTANCE al T donde se acepta con INITIAL_ACCEPTANCE (estimados en cada corrida)
+const bool use_tempering = false; // true to run replica exchange instead of a single SA chain
+const int NUM_REPLICAS = 8; // one thread each
+const int TEMPERING_EXCHANGES = 200;
+const int TEMPERING_STEPS = 50; // steps of every replica between exchanges
+typedef BasicParallelTempering<Annealer::CostPolicy, Annealer::ConnectivityPolicy> Tempering;
 
 //Variables Globales - Parametros experimentos
 const std::string instances_dir = "instancias"; 
 const std::string output_data = "sim_ann_results.csv";
+const std::string runs_data = "sim_ann_runs.csv"; // one row per simulation, written while the sweep runs
+const bool resume_sweep = false; // true to keep the runs already in runs_data (same parameters) and run the rest
 const int NUM_SIMULATIONS = 1000; 
+const int NUM_THREADS = 0; // 0 = all cores
+const unsigned MASTER_SEED = 0; // 0 = seed from std::random_device, fixed value to repeat a sweep
 const bool verbose = false; // true to print detailed output
+const OccupancyGrid::Mode grid_mode = OccupancyGrid::BYTES; // BITMAP for 1 bit per cell
+const SeedMethod seed_method = SEED_ASTAR; // initial path: SEED_ASTAR, SEED_JPS or SEED_DFS (original)
+
+//Telemetria, solo si se compila con make TELEMETRY=1 (si no, no se escribe nada)
+const std::string telemetry_data = "sim_ann_telemetry"; // .csv (+ sim_ann_trace.csv) or .json
+const std::string trace_data = "sim_ann_trace.csv";
+const TelemetryFormat telemetry_format = TELEMETRY_CSV; // or TELEMETRY_JSON
+const int TRACE_EVERY = 50; // iterations between trace samples, 0 = counters only
+
+//Modo batch de consultas (./main --queries grid [consultas]), ver query.h
+const size_t QUERY_BLOCK = 256; // queries read and answered together, in parallel over NUM_THREADS
+const bool use_pyramid = false; // coarse-to-fine annealing (pyramid.h), for large maps with wide passages
+const int PYRAMID_MIN_SIDE = 64; // longest side of the coarsest level
+const int CORRIDOR_RADIUS = 2;   // cells kept around the projected path at each finer level
+const bool QUERY_CHAIN_CODES = false; // answer paths as first point + one direction digit per step (chain.h)
+typedef BasicPyramidAnnealing<Annealer::CostPolicy, Annealer::ConnectivityPolicy> PyramidAnnealer;
+
+//Modo de varios agentes (./main --agents grid [agentes]), una linea "sx sy ex ey" por agente, ver multi_agent.h
+const double AGENT_T = 0.5;               // temperature of each group at the start of a round
+const double AGENT_TEMP_THRESHOLD = 0.05; // and at its end
+const double AGENT_CONFLICT_WEIGHT = 10.0; // cost of one conflict
+const double AGENT_ARRIVAL_WEIGHT = 1.0;  // cost of each time step before an agent stays at its goal
+const long AGENT_ITERATIONS = 2000;       // per agent of a group and round
+const int AGENT_ROUNDS = 8;
+const double AGENT_HORIZON_SLACK = 0.25;  // time steps over the longest seed path, as a fraction of it
+typedef BasicMultiAgentAnnealing<Annealer::CostPolicy, Annealer::ConnectivityPolicy> MultiAgentPlanner;
 
 std::vector<std::string> instance_files = {
         "prob_10_11s.prob",
@@ -39,16 +108,49 @@ struct SimulationResult {
     double best_cost;
     double cost_difference;
     double execution_time_ms;
+    long iterations;
+    double final_temperature;
+    int reheats;
+    Telemetry telemetry; // empty without SA_TELEMETRY
+};
+
+//Estado de cada hilo del modo batch, se reutiliza entre consultas
+struct QueryWorker {
+    std::unique_ptr<Annealer> annealer;
+    std::unique_ptr<PyramidAnnealer> pyramid_annealer; // only with use_pyramid
+    SearchContext context;
 };
 
 //Declaracion Funciones
-void parse_instance(const std::string& path, GridInstance& grid_instance);
 void print_grid_with_path(const GridInstance& grid_instance, const std::vector<std::pair<int, int>>& path);
-SimulationResult run_single_simulation(const std::string& instance_path, unsigned seed);
-void run_multiple_simulations(const std::string& instance_path, int num_simulations, 
+void configure_annealer(Annealer& sa);
+SimulationResult run_single_simulation(const CachedInstance& instance, unsigned seed);
+void run_multiple_simulations(const std::vector<std::string>& instance_paths, int num_simulations, 
                             std::ofstream& output_file);
+void write_instance_results(const std::string& instance_path, const std::string& schedule,
+                            const InstanceSummary* summary, std::ofstream& output_file);
+void write_telemetry(const std::vector<std::string>& instance_paths, const std::vector<unsigned>& seeds,
+                     const std::vector<SimulationResult>& results, int num_simulations);
+RouteAnswer answer_query(const GridInstance& base, const GridPyramid& pyramid, const RouteQuery& query,
+                         QueryWorker& worker);
+int run_query_mode(const std::string& grid_path, const std::string& query_path);
+int run_agent_mode(const std::string& grid_path, const std::string& agents_path);
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--queries") {
+        if (argc < 3) {
+            std::cerr << "usage: " << argv[0] << " --queries grid_file [query_file, - or nothing for stdin]" << std::endl;
+            return 1;
+        }
+        return run_query_mode(argv[2], argc > 3 ? argv[3] : "-");
+    }
+    if (argc > 1 && std::string(argv[1]) == "--agents") {
+        if (argc < 3) {
+            std::cerr << "usage: " << argv[0] << " --agents grid_file [agents_file, - or nothing for stdin]" << std::endl;
+            return 1;
+        }
+        return run_agent_mode(argv[2], argc > 3 ? argv[3] : "-");
+    }
 
     const std::string OUTPUT_FILE = output_data;
     std::ofstream output_file(OUTPUT_FILE);
@@ -57,12 +159,16 @@ int main() {
         return 1;
     }
     
-    output_file << "instance_name,mean_initial_cost,mean_best_cost,mean_cost_difference,mean_execution_time_ms\n";
+    output_file << "instance_name,mean_initial_cost,mean_best_cost,mean_cost_difference,mean_execution_time_ms,"
+                   "runs,stddev_best_cost,median_best_cost,p95_best_cost,p99_best_cost,mean_iterations,"
+                   "stddev_execution_time_ms,median_execution_time_ms,p95_execution_time_ms,p99_execution_time_ms,"
+                   "schedule,mean_final_temperature,mean_reheats\n";
 
+    std::vector<std::string> instance_paths;
     for (const auto& filename : instance_files) {
-        std::string fullpath = instances_dir + "/" + filename;
-        run_multiple_simulations(fullpath, NUM_SIMULATIONS, output_file);
+        instance_paths.push_back(instances_dir + "/" + filename);
     }
+    run_multiple_simulations(instance_paths, NUM_SIMULATIONS, output_file);
     output_file.close();
     std::cout << "\nAll simulations completed. Results saved to " << OUTPUT_FILE << std::endl;
 
@@ -73,14 +179,23 @@ int main() {
 
 // Printear el grid con el camino encontrado con 9 como camino, usada cuando verbose es true
 void print_grid_with_path(const GridInstance& grid_instance, const std::vector<std::pair<int, int>>& path) {
-    std::vector<std::vector<int>> display_grid = grid_instance.grid;
+    std::vector<int> display_grid((size_t)grid_instance.rows * grid_instance.cols);
+    
+    for (int y = 0; y < grid_instance.rows; ++y) {
+        for (int x = 0; x < grid_instance.cols; ++x) {
+            display_grid[(size_t)y * grid_instance.cols + x] = grid_instance.grid.blocked(x, y) ? 1 : 0;
+        }
+    }
+    display_grid[(size_t)grid_instance.start.second * grid_instance.cols + grid_instance.start.first] = 2;
+    display_grid[(size_t)grid_instance.end.second * grid_instance.cols + grid_instance.end.first] = 3;
     
     for (size_t i = 1; i < path.size() - 1; ++i) {
         int x = path[i].first;
         int y = path[i].second;
-        if (x >= 0 && x < grid_instance.cols && y >= 0 && y < grid_instance.rows) {
-            if (display_grid[y][x] != 2 && display_grid[y][x] != 3) { // Don't overwrite start/end
-                display_grid[y][x] = 9; // 9 as the sol
+        if (grid_instance.grid.in_bounds(x, y)) {
+            int& cell = display_grid[(size_t)y * grid_instance.cols + x];
+            if (cell != 2 && cell != 3) { // Don't overwrite start/end
+                cell = 9; // 9 as the sol
             }
         }
     }
@@ -88,7 +203,7 @@ void print_grid_with_path(const GridInstance& grid_instance, const std::vector<s
     std::cout << "\nGrid with best path (9 = path, 0 = free, 1 = obstacle, 2 = start, 3 = end):" << std::endl;
     for (int y = 0; y < grid_instance.rows; ++y) {
         for (int x = 0; x < grid_instance.cols; ++x) {
-            std::cout << display_grid[y][x];
+            std::cout << display_grid[(size_t)y * grid_instance.cols + x];
             if (x < grid_instance.cols - 1) std::cout << ",";
         }
         std::cout << std::endl;
@@ -96,76 +211,64 @@ void print_grid_with_path(const GridInstance& grid_instance, const std::vector<s
     std::cout << std::endl;
 }
 
-// Parse de las instancias usando coordenadas (x, y) para el grid
-void parse_instance(const std::string& path, GridInstance& grid_instance) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "file error" << path << std::endl;
-        return;
-    }
-    
-    std::vector<std::vector<int>> grid;
-    std::string line;
-    int row = 0;
-    
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-        
-        std::vector<int> grid_row;
-        std::stringstream ss(line);
-        std::string cell;
-        int col = 0;
-        
-        while (std::getline(ss, cell, ',')) {
-            int value = std::stoi(cell);
-            grid_row.push_back(value);
-            if (value == 2) { // start
-                grid_instance.start = {col, row};
-            } else if (value == 3) { // end
-                grid_instance.end = {col, row};
-            }
-            col++;
-        }
-        
-        grid.push_back(grid_row);
-        row++;
-    }
-    
-    grid_instance.grid = grid;
-    grid_instance.rows = grid.size();
-    grid_instance.cols = grid.empty() ? 0 : grid[0].size();
-    
-    file.close();
-    
-    std::cout << "Parsed grid: " << grid_instance.rows << "x" << grid_instance.cols << std::endl;
-    std::cout << "Start: (" << grid_instance.start.first << ", " << grid_instance.start.second << ")" << std::endl;
-    std::cout << "End: (" << grid_instance.end.first << ", " << grid_instance.end.second << ")" << std::endl;
+//Parametros de main para una corrida de SA (los de T van en el constructor o en init)
+void configure_annealer(Annealer& sa) {
+    sa.batch_size = BATCH_SIZE;
+    sa.batch_selection = batch_selection;
+    for (int t = 0; t < NUM_MOVE_TYPES; ++t) sa.move_weights[t] = MOVE_WEIGHTS[t];
+    sa.shortening_window = SHORTENING_WINDOW;
+    sa.seed_method = seed_method;
+    sa.telemetry.set_trace_every(TRACE_EVERY);
+    sa.schedule.kind = cooling_kind;
+    sa.schedule.steps_per_temperature = STEPS_PER_TEMPERATURE;
+    sa.schedule.temperature_steps = LUNDY_TEMPERATURE_STEPS;
+    sa.schedule.initial_samples = INITIAL_T_SAMPLES;
+    sa.schedule.initial_acceptance = INITIAL_ACCEPTANCE;
+    sa.schedule.final_acceptance = FINAL_ACCEPTANCE;
+    sa.schedule.max_reheats = MAX_REHEATS;
+    sa.schedule.reheat_window = REHEAT_WINDOW;
+    sa.schedule.reheat_fraction = REHEAT_FRACTION;
 }
 
-//Run de una sola simulacion, para no tener problemas con la aleatoriedad, tambien se mide el tiempo de ejecucion
-SimulationResult run_single_simulation(const std::string& instance_path, unsigned seed) {
+//Run de una sola simulacion, para no tener problemas con la aleatoriedad, tambien se mide el tiempo de ejecucion.
+// La instancia viene ya leida y con su camino inicial, asi el tiempo medido es solo el de SA
+SimulationResult run_single_simulation(const CachedInstance& instance, unsigned seed) {
     SimulationResult result;
     
-    GridInstance grid_instance;
-    parse_instance(instance_path, grid_instance);
-    
-    if (grid_instance.grid.empty()) {
-        std::cerr << "Failed to parse instance file: " << instance_path << std::endl;
-        result.initial_cost = -1.0;
-        result.best_cost = -1.0;
-        result.cost_difference = 0.0;
-        result.execution_time_ms = 0.0;
-        return result;
-    }
-    
     auto start_time = std::chrono::high_resolution_clock::now();
     
-    SimulatedAnnealing sa(T, cooling_rate, temp_threshold, grid_instance);
-    sa.set_random_seed(seed); // Set a specific seed for this run, to have randomness
-    
-    result.initial_cost = sa.evaluate_cost(sa.Current_sol);
-    sa.run(verbose); // false to not print details
-    result.best_cost = sa.evaluate_cost(sa.Best_sol);
+    result.initial_cost = instance.initial_cost;
+    if (use_tempering) {
+        Tempering pt(instance.grid_instance, instance.initial_path, NUM_REPLICAS, seed);
+        for (auto& replica : pt.replicas) {
+            configure_annealer(*replica); // same moves, batches and policies as a single chain
+            replica->telemetry.add_phase(PHASE_SEED, instance.seed_ms);
+        }
+        pt.run(TEMPERING_EXCHANGES, TEMPERING_STEPS, verbose);
+        result.initial_cost = pt.replicas[0]->evaluate_cost(instance.initial_path); // with the cost policy of Annealer
+        result.best_cost = pt.replicas[0]->evaluate_cost(pt.Best_sol);
+        result.iterations = pt.replicas[0]->iterations;
+        result.final_temperature = pt.replicas[0]->T;
+        result.reheats = 0;
+        result.telemetry = pt.replicas[0]->telemetry; // counters of the coldest replica, no trace
+    } else {
+        Annealer sa(T, cooling_rate, temp_threshold, instance.grid_instance, instance.initial_path);
+        sa.set_random_seed(seed); // Set a specific seed for this run, to have randomness
+        configure_annealer(sa);
+        sa.telemetry.add_phase(PHASE_SEED, instance.seed_ms); // searched once by the cache
+        
+        RunLimits limits;
+        limits.time_budget_ms = TIME_BUDGET_MS;
+        limits.max_iterations = MAX_ITERATIONS;
+        limits.stagnation_window = STAGNATION_WINDOW;
+        result.initial_cost = sa.evaluate_cost(instance.initial_path); // with the cost policy of Annealer
+        sa.run_anytime(limits, nullptr, verbose); // false to not print details
+        result.best_cost = sa.evaluate_cost(sa.Best_sol);
+        result.iterations = sa.iterations;
+        result.final_temperature = sa.T;
+        result.reheats = sa.schedule.reheats;
+        result.telemetry = sa.telemetry;
+    }
     result.cost_difference = result.initial_cost - result.best_cost;
 
     auto end_time = std::chrono::high_resolution_clock::now();
@@ -174,59 +277,378 @@ SimulationResult run_single_simulation(const std::string& instance_path, unsigne
     return result;
 }
 
-// Run de multiples simulaciones para una instancia, ocupando la funcion anterior para medir
-// lo necesario para los resultados
-void run_multiple_simulations(const std::string& instance_path, int num_simulations, 
+// Run de multiples simulaciones para todas las instancias en paralelo, ocupando la funcion anterior.
+// Las semillas se generan en orden antes de repartir las tareas. Cada simulacion se pasa al
+// ResultsWriter al terminar (runs_data) y los resumenes por instancia salen de ahi, asi el CSV
+// no depende de que hilo ejecuto cada simulacion. Con resume_sweep se saltan las ya escritas
+void run_multiple_simulations(const std::vector<std::string>& instance_paths, int num_simulations, 
                             std::ofstream& output_file) {
-    double total_initial_cost = 0.0;
-    double total_best_cost = 0.0;
-    double total_cost_difference = 0.0;
-    double total_execution_time = 0.0;
-    int successful_runs = 0;
+    size_t total_runs = instance_paths.size() * num_simulations;
+    std::vector<unsigned> seeds(total_runs);
+    std::vector<SimulationResult> results(Telemetry::enabled ? total_runs : 0); // only kept for the telemetry
+
+    ResultsWriter writer(runs_data, resume_sweep);
+    if (!writer.is_open()) {
+        std::cerr << "file error" << runs_data << std::endl;
+        return;
+    }
+    if (writer.resumed() > 0) {
+        std::cout << "Resuming, " << writer.resumed() << " runs already in " << runs_data << std::endl;
+    }
+    const std::string schedule = use_tempering ? "tempering" : cooling_kind_name(cooling_kind);
+    std::vector<std::string> instance_names;
+    for (const auto& instance_path : instance_paths) {
+        instance_names.push_back(instance_path.substr(instance_path.find_last_of("/\\") + 1));
+    }
                                 
     std::random_device rd; //random numbers gen
-    std::mt19937 gen(rd());
+    std::mt19937 gen(MASTER_SEED != 0 ? MASTER_SEED : rd());
+    for (size_t i = 0; i < total_runs; ++i) {
+        seeds[i] = gen();// new seed for each simulation
+    }
     
-    std::cout << "Running " << num_simulations << " simulations for " << instance_path << std::endl;
+    // every instance is parsed once, before the threads start
+    InstanceCache cache(grid_mode, seed_method, Annealer::ConnectivityPolicy::DEGREE);
+    std::vector<std::shared_ptr<const CachedInstance>> instances;
+    for (const auto& instance_path : instance_paths) {
+        std::cout << "Running " << num_simulations << " simulations for " << instance_path << std::endl;
+        instances.push_back(cache.get(instance_path));
+    }
+    int num_threads = use_tempering ? 1 : NUM_THREADS; // tempering already uses one thread per replica
+    std::cout << "Using " << resolve_thread_count(num_threads) << " threads" << std::endl;
     
-    for (int i = 0; i < num_simulations; ++i) {
-        unsigned seed = gen();// new seed for each simulation
-        
-        SimulationResult result = run_single_simulation(instance_path, seed);
-        
-        if (result.initial_cost >= 0.0) {
-            total_initial_cost += result.initial_cost;
-            total_best_cost += result.best_cost;
-            total_cost_difference += result.cost_difference;
-            total_execution_time += result.execution_time_ms;
-            successful_runs++;
+    std::atomic<int> completed(0);
+    parallel_for(total_runs, num_threads, [&](size_t i, int) {
+        const std::shared_ptr<const CachedInstance>& instance = instances[i / num_simulations];
+        const std::string& instance_name = instance_names[i / num_simulations];
+        int run = (int)(i % num_simulations);
+        RunRecord record;
+        if (!instance || writer.completed(instance_name, schedule, run, record)) {
+            if (!instance) std::cerr << "Failed to parse instance file: " << instance_paths[i / num_simulations] << "\n";
+            if (Telemetry::enabled) results[i].initial_cost = -1.0; // not run, no telemetry
+            return;
         }
+        SimulationResult result = run_single_simulation(*instance, seeds[i]);
+        record.instance_name = instance_name;
+        record.run = run;
+        record.seed = seeds[i];
+        record.initial_cost = result.initial_cost;
+        record.best_cost = result.best_cost;
+        record.iterations = result.iterations;
+        record.execution_time_ms = result.execution_time_ms;
+        record.schedule = schedule;
+        record.final_temperature = result.final_temperature;
+        record.reheats = result.reheats;
+        writer.push(record); // written by the writer thread, outside the measured time
+        if (Telemetry::enabled) results[i] = result;
+        
+        int done = ++completed;
         if (verbose){
-            if ((i + 1) % 10 == 0 || i + 1 == num_simulations) {
-            std::cout << "Completed " << (i + 1) << " of " << num_simulations << " simulations" << std::endl;
+            if (done % 10 == 0 || done == (int)total_runs) {
+            std::cout << "Completed " << done << " of " << total_runs << " simulations" << std::endl;
         }
         }
-    }
+    });
     
-    if (successful_runs > 0) {
-        double mean_initial_cost = total_initial_cost / successful_runs;
-        double mean_best_cost = total_best_cost / successful_runs;
-        double mean_cost_difference = total_cost_difference / successful_runs;
-        double mean_execution_time = total_execution_time / successful_runs;
-        
+    writer.close();
+    std::cout << "Runs saved to " << runs_data << std::endl;
+    for (size_t k = 0; k < instance_paths.size(); ++k) {
+        auto it = writer.summaries().find(SummaryKey(instance_names[k], schedule));
+        write_instance_results(instance_paths[k], schedule, it != writer.summaries().end() ? &it->second : nullptr,
+                               output_file);
+    }
+    if (Telemetry::enabled) {
+        write_telemetry(instance_paths, seeds, results, num_simulations);
+    }
+}
+
+// Telemetria de cada simulacion (contadores, tiempos por fase y traza) junto al CSV de resultados
+void write_telemetry(const std::vector<std::string>& instance_paths, const std::vector<unsigned>& seeds,
+                     const std::vector<SimulationResult>& results, int num_simulations) {
+    bool csv = telemetry_format == TELEMETRY_CSV;
+    std::string summary_path = telemetry_data + (csv ? ".csv" : ".json");
+    std::ofstream summary(summary_path);
+    std::ofstream trace;
+    if (csv) trace.open(trace_data);
+    if (!summary.is_open() || (csv && !trace.is_open())) {
+        std::cerr << "file error" << summary_path << std::endl;
+        return;
+    }
+
+    write_telemetry_header(summary, trace, telemetry_format);
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].initial_cost < 0.0) continue; // instance not parsed or run resumed
+        const std::string& instance_path = instance_paths[i / num_simulations];
         std::string instance_name = instance_path.substr(instance_path.find_last_of("/\\") + 1);
-        output_file << instance_name << ","
-                   << std::fixed << std::setprecision(4) << mean_initial_cost << ","
-                   << std::fixed << std::setprecision(4) << mean_best_cost << ","
-                   << std::fixed << std::setprecision(4) << mean_cost_difference << ","
-                   << std::fixed << std::setprecision(2) << mean_execution_time << "\n";
-        
-        std::cout << "Results for " << instance_name << ":" << std::endl;
-        std::cout << "  Mean Initial Cost: " << mean_initial_cost << std::endl;
-        std::cout << "  Mean Best Cost: " << mean_best_cost << std::endl;
-        std::cout << "  Mean Cost Difference: " << mean_cost_difference << std::endl;
-        std::cout << "  Mean Execution Time: " << mean_execution_time << " ms" << std::endl;
-    } else {
+        write_telemetry_run(summary, trace, telemetry_format, instance_name, (int)(i % num_simulations),
+                            seeds[i], results[i].telemetry);
+    }
+    std::cout << "Telemetry saved to " << summary_path << (csv ? " and " + trace_data : "") << std::endl;
+}
+
+// Resumen de las simulaciones de una instancia (promedios, desviacion estandar, mediana, p95 y p99
+// del mejor costo y del tiempo), se escribe como una fila del CSV
+void write_instance_results(const std::string& instance_path, const std::string& schedule,
+                            const InstanceSummary* summary, std::ofstream& output_file) {
+    std::string instance_name = instance_path.substr(instance_path.find_last_of("/\\") + 1);
+    if (!summary || summary->best_cost.count() == 0) {
         std::cerr << "error with the simulations" << instance_path << std::endl;
+        return;
+    }
+    const RunningStats& cost = summary->best_cost;
+    const RunningStats& time = summary->execution_time_ms;
+
+    output_file << instance_name << ","
+               << std::fixed << std::setprecision(4) << summary->initial_cost.mean() << ","
+               << cost.mean() << ","
+               << summary->cost_difference.mean() << ","
+               << std::setprecision(2) << time.mean() << ","
+               << cost.count() << ","
+               << std::setprecision(4) << cost.stddev() << "," << cost.percentile(50) << ","
+               << cost.percentile(95) << "," << cost.percentile(99) << ","
+               << std::setprecision(1) << summary->iterations.mean() << ","
+               << std::setprecision(4) << time.stddev() << "," << time.percentile(50) << ","
+               << time.percentile(95) << "," << time.percentile(99) << ","
+               << schedule << "," << std::setprecision(6) << summary->final_temperature.mean() << ","
+               << std::setprecision(2) << summary->reheats.mean() << "\n";
+
+    std::cout << std::defaultfloat << std::setprecision(6);
+    std::cout << "Results for " << instance_name << " (" << cost.count() << " runs, " << schedule << "):\n";
+    std::cout << "  Mean Initial Cost: " << summary->initial_cost.mean() << "\n";
+    std::cout << "  Mean Best Cost: " << cost.mean() << " (median " << cost.percentile(50)
+              << ", p95 " << cost.percentile(95) << ", p99 " << cost.percentile(99) << ")\n";
+    std::cout << "  Mean Cost Difference: " << summary->cost_difference.mean() << "\n";
+    std::cout << "  Mean Execution Time: " << time.mean() << " ms (median " << time.percentile(50)
+              << ", p95 " << time.percentile(95) << ", p99 " << time.percentile(99) << ")" << std::endl;
+}
+
+//Responde una consulta sobre el grid ya cargado: busca el camino inicial y corre SA con los limites
+// de main (el presupuesto de la consulta reemplaza TIME_BUDGET_MS). Cada hilo reutiliza su Annealer,
+// con las tablas de la politica de costo ya preparadas, y su SearchContext.
+// Con use_pyramid el camino se busca y templa de grueso a fino, el presupuesto es para todos los niveles
+RouteAnswer answer_query(const GridInstance& base, const GridPyramid& pyramid, const RouteQuery& query,
+                         QueryWorker& worker) {
+    RouteAnswer answer;
+    if (!query.error.empty()) {
+        answer.error = query.error;
+        return answer;
+    }
+    RunLimits limits;
+    limits.time_budget_ms = query.budget_ms > 0.0 ? query.budget_ms : TIME_BUDGET_MS;
+    limits.max_iterations = MAX_ITERATIONS;
+    limits.stagnation_window = STAGNATION_WINDOW;
+
+    if (use_pyramid) {
+        if (!worker.pyramid_annealer) {
+            worker.pyramid_annealer.reset(new PyramidAnnealer(T, cooling_rate, temp_threshold, pyramid));
+            worker.pyramid_annealer->corridor_radius = CORRIDOR_RADIUS;
+            worker.pyramid_annealer->seed_method = seed_method;
+            worker.pyramid_annealer->search_context = &worker.context;
+            worker.pyramid_annealer->configure = [](Annealer& sa, int) { configure_annealer(sa); };
+        }
+        PyramidAnnealer& pa = *worker.pyramid_annealer;
+        pa.random_seed = query.seed;
+        pa.limits = limits;
+        if (!pa.run(query.start, query.end)) {
+            answer.error = "no path between start and end";
+            return answer;
+        }
+        for (const PyramidLevelStats& stats : pa.level_stats) {
+            answer.search_ms += stats.search_ms;
+            answer.anneal_ms += stats.anneal_ms;
+            answer.iterations += stats.iterations;
+        }
+        answer.ok = true;
+        answer.initial_cost = pa.level_stats.back().seed_cost; // level 0 path found in the corridor
+        answer.cost = pa.best_cost;
+        answer.stop_reason = pa.annealers[0]->stop_reason;
+        answer.path.encode(pa.Best_sol);
+        return answer;
+    }
+
+    GridInstance grid_instance = base; // the grid and the masks are shared, not copied
+    grid_instance.start = query.start;
+    grid_instance.end = query.end;
+
+    auto search_start = std::chrono::high_resolution_clock::now();
+    std::vector<std::pair<int, int>> path;
+    bool found = find_path(grid_instance.grid, query.start, query.end, seed_method, worker.context, path,
+                           Annealer::ConnectivityPolicy::DEGREE);
+    auto search_end = std::chrono::high_resolution_clock::now();
+    answer.search_ms = std::chrono::duration<double, std::milli>(search_end - search_start).count();
+    if (!found) {
+        answer.error = "no path between start and end";
+        return answer;
+    }
+
+    std::unique_ptr<Annealer>& annealer = worker.annealer;
+    if (!annealer) {
+        annealer.reset(new Annealer(T, cooling_rate, temp_threshold, grid_instance, path));
+    } else {
+        annealer->init(T, cooling_rate, temp_threshold, grid_instance);
+        annealer->telemetry = Telemetry();
+        annealer->Current_sol = path;
+        annealer->Best_sol = path;
+    }
+    Annealer& sa = *annealer;
+    sa.set_random_seed(query.seed);
+    configure_annealer(sa);
+    sa.search_context = &worker.context;
+
+    answer.initial_cost = sa.evaluate_cost(path);
+    answer.stop_reason = sa.run_anytime(limits);
+    answer.anneal_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - search_end).count();
+
+    answer.ok = true;
+    answer.path.encode(sa.Best_sol);
+    answer.cost = sa.evaluate_cost(sa.Best_sol);
+    answer.iterations = sa.iterations;
+    return answer;
+}
+
+//Modo batch: carga el grid una vez (las celdas 2 y 3 del archivo se ignoran) y responde las consultas
+// de query_path ("-" = stdin) en bloques de QUERY_BLOCK en paralelo. Las respuestas salen por stdout
+// en el orden de entrada, una linea JSON por consulta, y se vacian al terminar cada bloque.
+// Los mensajes de la carga van a stderr para no mezclarse con las respuestas
+int run_query_mode(const std::string& grid_path, const std::string& query_path) {
+    std::ios::sync_with_stdio(false); // buffered stdin, read_query_block sees when no input is pending
+
+    GridInstance grid_instance;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(std::cerr.rdbuf());
+    bool loaded = load_instance(grid_path, grid_instance, grid_mode);
+    std::cout.rdbuf(stdout_buffer);
+    if (!loaded) {
+        std::cerr << "Failed to parse instance file: " << grid_path << std::endl;
+        return 1;
     }
-}
\ No newline at end of file
+    grid_instance.masks = NeighborMasks::build(grid_instance.grid); // shared by every query
+    GridPyramid pyramid;
+    if (use_pyramid) pyramid = GridPyramid::build(grid_instance, PYRAMID_MIN_SIDE);
+
+    std::ifstream query_file;
+    if (query_path != "-") {
+        query_file.open(query_path);
+        if (!query_file.is_open()) {
+            std::cerr << "file error" << query_path << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = query_path != "-" ? static_cast<std::istream&>(query_file) : std::cin;
+
+    int num_threads = resolve_thread_count(NUM_THREADS);
+    std::vector<QueryWorker> workers(num_threads);
+    std::vector<RouteQuery> block;
+    std::vector<RouteAnswer> answers;
+    long line_number = 0;
+    long answered = 0;
+    std::cerr << "Answering queries on " << grid_path << " with " << num_threads << " threads";
+    if (use_pyramid) std::cerr << " and a " << pyramid.levels() << " level pyramid";
+    std::cerr << std::endl;
+
+    while (read_query_block(in, QUERY_BLOCK, line_number, block)) {
+        answers.assign(block.size(), RouteAnswer());
+        for (RouteQuery& query : block) validate_query(grid_instance.grid, query);
+        parallel_for(block.size(), num_threads, [&](size_t i, int worker) {
+            answers[i] = answer_query(grid_instance, pyramid, block[i], workers[worker]);
+        });
+        for (size_t i = 0; i < block.size(); ++i) write_answer(std::cout, block[i], answers[i], QUERY_CHAIN_CODES);
+        std::cout.flush();
+        answered += block.size();
+    }
+    std::cerr << "Answered " << answered << " queries" << std::endl;
+    return 0;
+}
+
+//Modo de varios agentes: lee todos los agentes (mismo formato que las consultas, sin semilla ni
+// presupuesto), los planifica juntos sin choques y escribe el camino con tiempos de cada uno, en el
+// orden de entrada. Dos agentes con el mismo inicio o el mismo final no se pueden planificar
+int run_agent_mode(const std::string& grid_path, const std::string& agents_path) {
+    GridInstance grid_instance;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(std::cerr.rdbuf());
+    bool loaded = load_instance(grid_path, grid_instance, grid_mode);
+    std::cout.rdbuf(stdout_buffer);
+    if (!loaded) {
+        std::cerr << "Failed to parse instance file: " << grid_path << std::endl;
+        return 1;
+    }
+
+    std::ifstream agents_file;
+    if (agents_path != "-") {
+        agents_file.open(agents_path);
+        if (!agents_file.is_open()) {
+            std::cerr << "file error" << agents_path << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = agents_path != "-" ? static_cast<std::istream&>(agents_file) : std::cin;
+    std::vector<RouteQuery> queries;
+    std::string line;
+    RouteQuery query;
+    for (long line_number = 1; std::getline(in, line); ++line_number) {
+        if (parse_query(line, line_number, query)) queries.push_back(query);
+    }
+
+    std::map<size_t, long> starts, ends; // cell -> id of the first agent there
+    std::vector<MultiAgentPlanner::Endpoints> endpoints;
+    std::vector<size_t> planned; // index in queries of each planned agent
+    for (size_t i = 0; i < queries.size(); ++i) {
+        RouteQuery& q = queries[i];
+        validate_query(grid_instance.grid, q);
+        if (!q.error.empty()) continue;
+        auto start = starts.insert({grid_instance.grid.index(q.start.first, q.start.second), q.id});
+        auto end = ends.insert({grid_instance.grid.index(q.end.first, q.end.second), q.id});
+        if (!start.second) {
+            q.error = "start shared with agent " + std::to_string(start.first->second);
+        } else if (!end.second) {
+            q.error = "end shared with agent " + std::to_string(end.first->second);
+        } else {
+            endpoints.push_back({q.start, q.end});
+            planned.push_back(i);
+        }
+    }
+
+    MultiAgentPlanner planner(grid_instance);
+    planner.T = AGENT_T;
+    planner.temp_threshold = AGENT_TEMP_THRESHOLD;
+    planner.conflict_weight = AGENT_CONFLICT_WEIGHT;
+    planner.arrival_weight = AGENT_ARRIVAL_WEIGHT;
+    planner.iterations_per_agent = AGENT_ITERATIONS;
+    planner.max_rounds = AGENT_ROUNDS;
+    planner.horizon_slack = AGENT_HORIZON_SLACK;
+    planner.num_threads = NUM_THREADS;
+    planner.seed_method = seed_method;
+    std::cerr << "Planning " << endpoints.size() << " agents on " << grid_path << std::endl;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    planner.plan(endpoints);
+    double plan_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start_time).count();
+
+    for (size_t k = 0; k < planned.size(); ++k) {
+        if (!planner.agents[k]) queries[planned[k]].error = "no path";
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        bool is_planned = k < planned.size() && planned[k] == i;
+        if (!queries[i].error.empty()) {
+            RouteAnswer answer;
+            answer.error = queries[i].error;
+            write_answer(std::cout, queries[i], answer);
+        } else {
+            write_agent_answer(std::cout, queries[i], planner.agents[k]->Current_sol, planner.arrival(k),
+                               planner.path_cost(k));
+        }
+        if (is_planned) k++;
+    }
+    std::cout.flush();
+
+    for (const MultiAgentRoundStats& round : planner.round_stats) {
+        std::cerr << "  round: horizon " << round.horizon << ", conflicts " << round.conflicts_before
+                  << " -> " << round.conflicts_after << ", " << round.groups << " groups with "
+                  << round.active_agents << " agents (largest " << round.largest_group << "), "
+                  << round.ms << " ms" << std::endl;
+    }
+    std::cerr << "Planned " << endpoints.size() << " agents in " << plan_ms << " ms, horizon "
+              << planner.horizon << ", " << planner.conflicts << " conflicts left" << std::endl;
+    return planner.conflicts == 0 ? 0 : 2;
+}
@@ -0,0 +1,380 @@
+#include "multi_agent.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include "chain.h"
+#include "parallel.h"
+
+namespace {
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int find_root(std::vector<int>& parent, int a) {
+    while (parent[a] != a) {
+        parent[a] = parent[parent[a]];
+        a = parent[a];
+    }
+    return a;
+}
+
+// Vertices lo..hi of path and the edges that enter or leave them, all with the same agent
+void reserve_range(ReservationTable& table, const std::vector<std::pair<int, int>>& path, int lo, int hi,
+                   int agent) {
+    for (int t = lo; t <= hi; ++t) table.add(path[t], t, agent);
+    for (int t = std::max(lo - 1, 0); t <= std::min(hi, (int) path.size() - 2); ++t) {
+        table.add_edge(path[t], path[t+1], t, agent);
+    }
+}
+
+void release_range(ReservationTable& table, const std::vector<std::pair<int, int>>& path, int lo, int hi) {
+    for (int t = lo; t <= hi; ++t) table.remove(path[t], t);
+    for (int t = std::max(lo - 1, 0); t <= std::min(hi, (int) path.size() - 2); ++t) {
+        table.remove_edge(path[t], path[t+1], t);
+    }
+}
+
+// Conflicts of the vertices lo..hi of path and their edges with the other agents: those of the
+// snapshot of the round (all of them) minus the group at the start of the round (own) plus the
+// group now (local). The agent of path must not be in local
+long range_conflicts(const ReservationTable& snapshot, const ReservationTable& own, const ReservationTable& local,
+                     const std::vector<std::pair<int, int>>& path, int lo, int hi) {
+    long conflicts = 0;
+    for (int t = lo; t <= hi; ++t) {
+        conflicts += snapshot.at(path[t], t) - own.at(path[t], t) + local.at(path[t], t);
+    }
+    for (int t = std::max(lo - 1, 0); t <= std::min(hi, (int) path.size() - 2); ++t) { // swaps
+        conflicts += snapshot.crossing(path[t+1], path[t], t) - own.crossing(path[t+1], path[t], t) +
+                     local.crossing(path[t+1], path[t], t);
+    }
+    return conflicts;
+}
+
+// First time from which path stays at its last point, scanning back from t. Every point after t
+// has to be there already
+int arrival_from(const std::vector<std::pair<int, int>>& path, int t) {
+    while (t > 0 && path[t-1] == path.back()) t--;
+    return t;
+}
+
+// Delays the stretch lo..hi - 1 of path one step: the agent waits at lo - 1 and the wait at hi,
+// path[hi] == path[hi - 1], is dropped. The inverse of advance
+void delay(std::vector<std::pair<int, int>>& path, int lo, int hi) {
+    std::rotate(path.begin() + lo, path.begin() + hi, path.begin() + hi + 1);
+    path[lo] = path[lo - 1];
+}
+
+// Advances the stretch lo + 1..hi of path one step: drops the wait at lo, path[lo] == path[lo - 1],
+// and the agent waits at hi. The inverse of delay
+void advance(std::vector<std::pair<int, int>>& path, int lo, int hi) {
+    std::rotate(path.begin() + lo, path.begin() + lo + 1, path.begin() + hi + 1);
+    path[hi] = path[hi - 1];
+}
+
+} // namespace
+
+uint64_t ReservationTable::edge_key(const std::pair<int, int>& from, const std::pair<int, int>& to, int t) const {
+    uint64_t cell = (uint64_t)((from.second + 1) * stride_ + from.first + 1);
+    int direction = ChainPath::direction_of(to.first - from.first, to.second - from.second);
+    return ((cell << 3 | (uint64_t) direction) << 24) | (uint64_t) t;
+}
+
+int ReservationTable::count_of(const std::unordered_map<uint64_t, Entry>& map, uint64_t key) {
+    auto it = map.find(key);
+    return it == map.end() ? 0 : it->second.count;
+}
+
+int ReservationTable::agent_of(const std::unordered_map<uint64_t, Entry>& map, uint64_t key) {
+    auto it = map.find(key);
+    return it == map.end() ? -1 : it->second.agent;
+}
+
+void ReservationTable::decrement(std::unordered_map<uint64_t, Entry>& map, uint64_t key) {
+    auto it = map.find(key);
+    if (it != map.end() && --it->second.count == 0) map.erase(it); // keeps the table to what is in use
+}
+
+int ReservationTable::at(const std::pair<int, int>& p, int t) const {
+    return count_of(vertices_, vertex_key(p, t));
+}
+
+int ReservationTable::occupant(const std::pair<int, int>& p, int t) const {
+    return agent_of(vertices_, vertex_key(p, t));
+}
+
+int ReservationTable::crossing(const std::pair<int, int>& from, const std::pair<int, int>& to, int t) const {
+    return from == to ? 0 : count_of(edges_, edge_key(from, to, t));
+}
+
+int ReservationTable::crosser(const std::pair<int, int>& from, const std::pair<int, int>& to, int t) const {
+    return from == to ? -1 : agent_of(edges_, edge_key(from, to, t));
+}
+
+void ReservationTable::add(const std::pair<int, int>& p, int t, int agent) {
+    Entry& entry = vertices_.insert({vertex_key(p, t), Entry{0, agent}}).first->second;
+    entry.count++;
+    entry.agent = agent;
+}
+
+void ReservationTable::remove(const std::pair<int, int>& p, int t) {
+    decrement(vertices_, vertex_key(p, t));
+}
+
+void ReservationTable::add_edge(const std::pair<int, int>& from, const std::pair<int, int>& to, int t, int agent) {
+    if (from == to) return;
+    Entry& entry = edges_.insert({edge_key(from, to, t), Entry{0, agent}}).first->second;
+    entry.count++;
+    entry.agent = agent;
+}
+
+void ReservationTable::remove_edge(const std::pair<int, int>& from, const std::pair<int, int>& to, int t) {
+    if (from != to) decrement(edges_, edge_key(from, to, t));
+}
+
+//Constructor, los valores por defecto son para costos de paso cerca de 1 (euclidiano)
+template <class Cost, class Connectivity>
+BasicMultiAgentAnnealing<Cost, Connectivity>::BasicMultiAgentAnnealing(const GridInstance& grid_instance)
+    : grid_instance(grid_instance), T(0.5), temp_threshold(0.05), conflict_weight(10.0), arrival_weight(1.0),
+      wait_move_rate(0.3),
+      iterations_per_agent(2000), max_rounds(8), horizon_slack(0.25), horizon_growth(8), num_threads(0),
+      seed_method(SEED_ASTAR), random_seed(1), horizon(0), conflicts(0) {
+    if (!this->grid_instance.masks.matches(this->grid_instance.grid)) { // shared by every agent
+        this->grid_instance.masks = NeighborMasks::build(this->grid_instance.grid);
+    }
+}
+
+//Planifica todos los agentes: caminos iniciales en paralelo, horizonte comun y rondas de
+// annealing de los grupos en conflicto hasta que no quedan conflictos o se acaban las rondas
+template <class Cost, class Connectivity>
+bool BasicMultiAgentAnnealing<Cost, Connectivity>::plan(const std::vector<Endpoints>& endpoints) {
+    size_t count = endpoints.size();
+    std::vector<std::vector<std::pair<int, int>>> paths(count);
+    std::vector<char> found(count, 0);
+    std::vector<SearchContext> contexts(resolve_thread_count(num_threads));
+    parallel_for(count, num_threads, [&](size_t i, int worker) {
+        found[i] = find_path(grid_instance.grid, endpoints[i].first, endpoints[i].second, seed_method,
+                             contexts[worker], paths[i], Connectivity::DEGREE);
+    });
+
+    size_t longest = 1;
+    for (size_t i = 0; i < count; ++i) {
+        if (found[i]) longest = std::max(longest, paths[i].size());
+    }
+    horizon = (int) longest + (int) std::ceil(horizon_slack * longest);
+
+    // one prototype prepares the cost policy, the agents copy it (its tables are shared)
+    Annealer prototype(T, 1.0, temp_threshold, grid_instance, std::vector<std::pair<int, int>>());
+    agents.clear();
+    agents.resize(count);
+    bool all_found = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (!found[i]) {
+            all_found = false;
+            continue;
+        }
+        paths[i].resize(horizon, endpoints[i].second); // waits at the end
+        Annealer* agent = new Annealer(prototype);
+        agent->grid_instance.start = endpoints[i].first;
+        agent->grid_instance.end = endpoints[i].second;
+        agent->Current_sol.swap(paths[i]);
+        agent->Best_sol = agent->Current_sol;
+        agent->current_cost = agent->best_cost = agent->evaluate_cost(agent->Current_sol);
+        agent->set_random_seed(random_seed + (unsigned) i);
+        agents[i].reset(agent);
+    }
+
+    round_stats.clear();
+    std::vector<std::vector<int>> groups;
+    conflicts = count_conflicts(&groups);
+    for (int round = 0; round < max_rounds && conflicts > 0; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        MultiAgentRoundStats stats;
+        stats.horizon = horizon;
+        stats.conflicts_before = conflicts;
+        stats.groups = groups.size();
+        stats.active_agents = 0;
+        stats.largest_group = 0;
+
+        for (const auto& group : groups) {
+            stats.active_agents += group.size();
+            stats.largest_group = std::max(stats.largest_group, group.size());
+        }
+        ReservationTable snapshot(grid_instance.grid.stride()); // read only while the groups run
+        for (size_t a = 0; a < count; ++a) {
+            if (agents[a]) reserve_range(snapshot, agents[a]->Current_sol, 0, horizon - 1, (int) a);
+        }
+        // largest groups first, the seed of a group only depends on the round and its first agent
+        std::sort(groups.begin(), groups.end(), [](const std::vector<int>& a, const std::vector<int>& b) {
+            return a.size() > b.size();
+        });
+        parallel_for(groups.size(), num_threads, [&](size_t g, int) {
+            anneal_group(groups[g], snapshot, random_seed + (unsigned)(round * count + groups[g].front()));
+        });
+
+        conflicts = count_conflicts(&groups);
+        if (conflicts > 0 && round + 1 < max_rounds && horizon_growth > 0) extend_horizon(horizon_growth);
+        stats.conflicts_after = conflicts;
+        stats.ms = ms_since(start);
+        round_stats.push_back(stats);
+    }
+    return all_found;
+}
+
+//Conflictos de todos los caminos, con una tabla nueva: cada agente se compara con los anteriores.
+// Con groups deja los grupos de agentes unidos por algun conflicto, cada uno ordenado
+template <class Cost, class Connectivity>
+long BasicMultiAgentAnnealing<Cost, Connectivity>::count_conflicts(std::vector<std::vector<int>>* groups) const {
+    ReservationTable table(grid_instance.grid.stride());
+    std::vector<int> parent(agents.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    long total = 0;
+    for (size_t a = 0; a < agents.size(); ++a) {
+        if (!agents[a]) continue;
+        const std::vector<std::pair<int, int>>& path = agents[a]->Current_sol;
+        for (int t = 0; t < (int) path.size(); ++t) {
+            int others = table.at(path[t], t);
+            if (others > 0) {
+                total += others;
+                parent[find_root(parent, (int) a)] = find_root(parent, table.occupant(path[t], t));
+            }
+            if (t + 1 < (int) path.size()) {
+                int swaps = table.crossing(path[t+1], path[t], t);
+                if (swaps > 0) {
+                    total += swaps;
+                    parent[find_root(parent, (int) a)] = find_root(parent, table.crosser(path[t+1], path[t], t));
+                }
+            }
+        }
+        reserve_range(table, path, 0, (int) path.size() - 1, (int) a);
+    }
+
+    if (groups) {
+        groups->clear();
+        std::vector<std::vector<int>> all(agents.size());
+        for (size_t a = 0; a < agents.size(); ++a) {
+            if (agents[a]) all[find_root(parent, (int) a)].push_back((int) a);
+        }
+        for (auto& group : all) {
+            if (group.size() > 1) groups->push_back(std::move(group)); // agents in order, joined by conflicts
+        }
+    }
+    return total;
+}
+
+//Templa los caminos de un grupo contra snapshot, los caminos de todos los agentes al inicio de la
+// ronda: los del grupo se descuentan con own y se cuentan como estan ahora en local, los demas se ven
+// como estaban (los de otros grupos de la ronda pueden haber cambiado). Cada iteracion elige un
+// agente del grupo y un movimiento, y calcula el cambio de conflictos solo en los tiempos que cambian
+template <class Cost, class Connectivity>
+void BasicMultiAgentAnnealing<Cost, Connectivity>::anneal_group(const std::vector<int>& group,
+                                                                const ReservationTable& snapshot, unsigned seed) {
+    ReservationTable own(grid_instance.grid.stride());
+    for (int a : group) reserve_range(own, agents[a]->Current_sol, 0, horizon - 1, a);
+    ReservationTable local = own;
+
+    std::vector<int> arrivals(group.size());
+    for (size_t g = 0; g < group.size(); ++g) arrivals[g] = arrival(group[g]);
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    long iterations = iterations_per_agent * (long) group.size();
+    double temperature = T;
+    double factor = std::pow(temp_threshold / T, 1.0 / std::max(1L, iterations));
+
+    for (long it = 0; it < iterations; ++it, temperature *= factor) {
+        size_t g = rng() % group.size();
+        int a = group[g];
+        Annealer& sa = *agents[a];
+        std::vector<std::pair<int, int>>& path = sa.Current_sol;
+
+        bool retime = horizon > 2 && uniform(rng) < wait_move_rate;
+        bool delayed = false;
+        Move move;
+        int lo, hi;
+        if (!retime) {
+            move = sa.propose_move(path);
+            if (move.index < 0) continue;
+            lo = hi = move.index;
+        } else {
+            lo = (int)(rng() % (horizon - 2)) + 1; // the start never moves
+            delayed = (rng() & 1) != 0;
+            if (!delayed && path[lo] != path[lo - 1]) continue; // advance needs a wait at lo
+            hi = lo + 1;
+            while (hi < horizon - 1 && path[hi] != path[hi - 1]) hi++; // next wait, or the last point
+            if (delayed && path[hi] != path[hi - 1]) continue; // delay needs a wait to drop
+        }
+
+        double path_delta = 0.0; // a wait adds no length, only turns can change when retiming
+        int window_lo = std::max(lo - 2, 0);
+        int window_hi = std::min(hi + 2, horizon - 1);
+        if (!retime) {
+            path_delta = sa.evaluate_delta(path, move);
+        } else if (Cost::HAS_TURNS) {
+            path_delta = -sa.window_cost(&path[window_lo], window_hi - window_lo + 1);
+        }
+
+        release_range(local, path, lo, hi);
+        long before = range_conflicts(snapshot, own, local, path, lo, hi);
+        if (!retime) {
+            sa.apply_move(move);
+        } else {
+            if (delayed) {
+                delay(path, lo, hi);
+            } else {
+                advance(path, lo, hi);
+            }
+            if (Cost::HAS_TURNS) path_delta += sa.window_cost(&path[window_lo], window_hi - window_lo + 1);
+        }
+        long after = range_conflicts(snapshot, own, local, path, lo, hi);
+        // the arrival only moves if the change reaches it, points after hi + 1 are still at the end
+        int arrival_after = hi + 1 < arrivals[g] ? arrivals[g] : arrival_from(path, std::min(hi + 1, horizon - 1));
+
+        double delta = path_delta + conflict_weight * (after - before) + arrival_weight * (arrival_after - arrivals[g]);
+        if (delta > 0 && uniform(rng) >= std::exp(-delta / temperature)) { // rejected, back to the old path
+            if (!retime) {
+                sa.revert_move(move);
+            } else if (delayed) {
+                advance(path, lo, hi);
+            } else {
+                delay(path, lo, hi);
+            }
+        } else {
+            sa.current_cost += path_delta;
+            arrivals[g] = arrival_after;
+        }
+        reserve_range(local, path, lo, hi, a);
+    }
+    for (int a : group) agents[a]->Best_sol = agents[a]->Current_sol;
+}
+
+template <class Cost, class Connectivity>
+void BasicMultiAgentAnnealing<Cost, Connectivity>::extend_horizon(int steps) {
+    horizon += steps;
+    for (auto& agent : agents) {
+        if (!agent) continue;
+        agent->Current_sol.resize(horizon, agent->Current_sol.back());
+        agent->Best_sol = agent->Current_sol;
+    }
+}
+
+template <class Cost, class Connectivity>
+int BasicMultiAgentAnnealing<Cost, Connectivity>::arrival(size_t agent) const {
+    const std::vector<std::pair<int, int>>& path = agents[agent]->Current_sol;
+    return arrival_from(path, (int) path.size() - 1);
+}
+
+template <class Cost, class Connectivity>
+double BasicMultiAgentAnnealing<Cost, Connectivity>::path_cost(size_t agent) {
+    return agents[agent]->evaluate_cost(agents[agent]->Current_sol);
+}
+
+template class BasicMultiAgentAnnealing<EuclideanCost, EightConnected>;
+template class BasicMultiAgentAnnealing<EuclideanCost, FourConnected>;
+template class BasicMultiAgentAnnealing<ManhattanCost, EightConnected>;
+template class BasicMultiAgentAnnealing<ManhattanCost, FourConnected>;
+template class BasicMultiAgentAnnealing<ClearanceCost, EightConnected>;
+template class BasicMultiAgentAnnealing<ClearanceCost, FourConnected>;
+template class BasicMultiAgentAnnealing<TurnPenaltyCost, EightConnected>;
+template class BasicMultiAgentAnnealing<TurnPenaltyCost, FourConnected>;
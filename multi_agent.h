@@ -0,0 +1,129 @@
+#ifndef MULTI_AGENT_H
+#define MULTI_AGENT_H
+
+#include <vector>
+#include <utility>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+#include "sim_ann.h"
+
+//Tabla de reservas espacio-tiempo de los caminos de varios agentes. El punto t de un camino es la
+// celda del agente en el tiempo t, un punto repetido es una espera. Cuenta cuantos agentes ocupan
+// cada (celda, t) y cuantos cruzan cada arista entre t y t + 1, asi los conflictos de un punto con
+// el resto se cuentan en O(1) esperado, sin recorrer los otros caminos. Guarda tambien el ultimo
+// agente que entro a cada entrada, para saber con quien es el conflicto
+class ReservationTable {
+public:
+    explicit ReservationTable(int stride = 0) : stride_(stride) {}
+
+    void clear() { vertices_.clear(); edges_.clear(); }
+    size_t size() const { return vertices_.size() + edges_.size(); }
+
+    int at(const std::pair<int, int>& p, int t) const; // agents in p at time t
+    int occupant(const std::pair<int, int>& p, int t) const; // last one added, -1 if none
+    // Agents that go from -> to between t and t + 1, 0 if from == to (a wait uses no edge)
+    int crossing(const std::pair<int, int>& from, const std::pair<int, int>& to, int t) const;
+    int crosser(const std::pair<int, int>& from, const std::pair<int, int>& to, int t) const;
+
+    void add(const std::pair<int, int>& p, int t, int agent);
+    void remove(const std::pair<int, int>& p, int t);
+    void add_edge(const std::pair<int, int>& from, const std::pair<int, int>& to, int t, int agent);
+    void remove_edge(const std::pair<int, int>& from, const std::pair<int, int>& to, int t);
+
+private:
+    struct Entry {
+        int count;
+        int agent;
+    };
+    // cell of the padded grid and time (24 bits), edges add the direction of the step
+    uint64_t vertex_key(const std::pair<int, int>& p, int t) const {
+        return ((uint64_t)((p.second + 1) * stride_ + p.first + 1) << 24) | (uint64_t) t;
+    }
+    uint64_t edge_key(const std::pair<int, int>& from, const std::pair<int, int>& to, int t) const;
+    static int count_of(const std::unordered_map<uint64_t, Entry>& map, uint64_t key);
+    static int agent_of(const std::unordered_map<uint64_t, Entry>& map, uint64_t key);
+    static void decrement(std::unordered_map<uint64_t, Entry>& map, uint64_t key);
+
+    int stride_;
+    std::unordered_map<uint64_t, Entry> vertices_;
+    std::unordered_map<uint64_t, Entry> edges_;
+};
+
+//Una ronda de BasicMultiAgentAnnealing::plan
+struct MultiAgentRoundStats {
+    int horizon;
+    long conflicts_before;
+    long conflicts_after;
+    size_t groups;        // groups of agents in conflict annealed in parallel
+    size_t active_agents; // agents in those groups, the rest stays fixed
+    size_t largest_group;
+    double ms;
+};
+
+//Planificacion conjunta de varios agentes sobre el mismo grid, sin choques. Cada agente parte con
+// su camino de costo minimo (find_path), todos con el mismo horizonte de tiempo: los caminos se
+// completan con esperas en su final, y un agente que llega se queda ahi.
+// Luego, por rondas, los agentes en conflicto (misma celda en el mismo tiempo, o cruzando la misma
+// arista en sentidos contrarios) se juntan en grupos conexos y cada grupo se templa en paralelo con
+// los demas, con costo = costo de los caminos + conflict_weight * conflictos + arrival_weight * tiempos de
+// llegada (sin este termino esperar no cuesta nada y las llegadas se corren al horizonte). Un grupo ve a los demas
+// agentes en una tabla de reservas de solo lectura con los caminos del inicio de la ronda; los
+// conflictos que queden entre grupos los junta la ronda siguiente.
+// Los movimientos son el desplazamiento de un punto de BasicSimulatedAnnealing, que no cambia los
+// tiempos, y retrasar o adelantar en un paso el tramo entre dos esperas. Cada movimiento actualiza
+// la tabla solo en los tiempos que cambia. Si una ronda termina con conflictos el horizonte crece
+template <class Cost, class Connectivity>
+class BasicMultiAgentAnnealing {
+public: // all public for easy access
+    typedef BasicSimulatedAnnealing<Cost, Connectivity> Annealer;
+    typedef std::pair<std::pair<int, int>, std::pair<int, int>> Endpoints; // start and end of an agent
+
+    //Parametros
+    GridInstance grid_instance; // the grid and its masks, start and end are not used
+    double T;                 // of every group, cooled geometrically to temp_threshold over its iterations
+    double temp_threshold;
+    double conflict_weight;   // cost of one conflict, a few times the cost of a step
+    double arrival_weight;    // cost of each time step before the agent stays at its end
+    double wait_move_rate;    // share of the moves that delay or advance a stretch of a path
+    long iterations_per_agent; // of a group in one round, times its number of agents
+    int max_rounds;
+    double horizon_slack;     // steps over the longest seed path, as a fraction of its length
+    int horizon_growth;       // steps added to every path after a round that ends with conflicts
+    int num_threads;          // 0 = all cores
+    SeedMethod seed_method;
+    unsigned random_seed;     // agent k uses random_seed + k
+
+    //Resultado
+    std::vector<std::unique_ptr<Annealer>> agents; // Current_sol is the timed path, nullptr without a path
+    int horizon;      // points of every path
+    long conflicts;   // left after plan()
+    std::vector<MultiAgentRoundStats> round_stats;
+
+    //Constructor
+    BasicMultiAgentAnnealing(const GridInstance& grid_instance);
+
+    //Funciones
+    // False if some agent has no path, that agent is left out (nullptr) and the others are planned
+    bool plan(const std::vector<Endpoints>& endpoints);
+    long count_conflicts(std::vector<std::vector<int>>* groups = nullptr) const; // optionally the groups
+    int arrival(size_t agent) const; // first time from which the agent stays at its end
+    double path_cost(size_t agent);
+
+    void anneal_group(const std::vector<int>& group, const ReservationTable& snapshot, unsigned seed);
+    void extend_horizon(int steps);
+};
+
+typedef BasicMultiAgentAnnealing<EuclideanCost, EightConnected> MultiAgentAnnealing;
+
+// Instantiated in multi_agent.cpp
+extern template class BasicMultiAgentAnnealing<EuclideanCost, EightConnected>;
+extern template class BasicMultiAgentAnnealing<EuclideanCost, FourConnected>;
+extern template class BasicMultiAgentAnnealing<ManhattanCost, EightConnected>;
+extern template class BasicMultiAgentAnnealing<ManhattanCost, FourConnected>;
+extern template class BasicMultiAgentAnnealing<ClearanceCost, EightConnected>;
+extern template class BasicMultiAgentAnnealing<ClearanceCost, FourConnected>;
+extern template class BasicMultiAgentAnnealing<TurnPenaltyCost, EightConnected>;
+extern template class BasicMultiAgentAnnealing<TurnPenaltyCost, FourConnected>;
+
+#endif // MULTI_AGENT_H
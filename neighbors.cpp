@@ -0,0 +1,104 @@
+#include "neighbors.h"
+#include <cstdlib>
+#include <algorithm>
+
+const int NEIGHBOR_OFFSETS[8][2] = {
+    {0, -1}, {1, 0}, {0, 1}, {-1, 0}, {1, -1}, {1, 1}, {-1, 1}, {-1, -1}
+};
+
+namespace {
+
+// adjacent[prev][next] with prev and next as (dy + 1) * 3 + (dx + 1)
+struct AdjacencyTable {
+    uint8_t adjacent[9][9];
+    uint8_t adjacent_4[9][9];
+    uint8_t nth[256][8];
+
+    AdjacencyTable() {
+        for (int p = 0; p < 9; ++p) {
+            for (int n = 0; n < 9; ++n) {
+                uint8_t mask = 0;
+                uint8_t mask_4 = 0;
+                for (int d = 0; d < 8; ++d) {
+                    int px = std::abs(NEIGHBOR_OFFSETS[d][0] - (p % 3 - 1));
+                    int py = std::abs(NEIGHBOR_OFFSETS[d][1] - (p / 3 - 1));
+                    int nx = std::abs(NEIGHBOR_OFFSETS[d][0] - (n % 3 - 1));
+                    int ny = std::abs(NEIGHBOR_OFFSETS[d][1] - (n / 3 - 1));
+                    if (std::max(px, py) <= 1 && std::max(nx, ny) <= 1) mask |= 1 << d;
+                    if (px + py <= 1 && nx + ny <= 1) mask_4 |= 1 << d;
+                }
+                adjacent[p][n] = mask;
+                adjacent_4[p][n] = mask_4;
+            }
+        }
+        for (int mask = 0; mask < 256; ++mask) {
+            int k = 0;
+            for (int d = 0; d < 8; ++d) {
+                if (mask & (1 << d)) nth[mask][k++] = (uint8_t) d;
+            }
+        }
+    }
+};
+
+const AdjacencyTable& table() {
+    static const AdjacencyTable instance; // built once, thread safe since C++11
+    return instance;
+}
+
+uint8_t cell_mask(const OccupancyGrid& grid, size_t i) {
+    uint8_t mask = 0;
+    int stride = grid.stride();
+    for (int d = 0; d < 8; ++d) {
+        if (!grid.blocked_at(i + NEIGHBOR_OFFSETS[d][1] * stride + NEIGHBOR_OFFSETS[d][0])) mask |= 1 << d;
+    }
+    return mask;
+}
+
+} // namespace
+
+//Mascaras de todas las celdas del grid, las del borde quedan en 0
+NeighborMasks NeighborMasks::build(const OccupancyGrid& grid) {
+    NeighborMasks result;
+    result.masks_ = std::make_shared<std::vector<uint8_t>>(grid.padded_cells(), 0);
+    result.key_ = GridStorageKey(grid);
+    std::vector<uint8_t>& masks = *result.masks_;
+    for (int y = 0; y < grid.rows(); ++y) {
+        for (int x = 0; x < grid.cols(); ++x) {
+            size_t i = grid.index(x, y);
+            masks[i] = cell_mask(grid, i);
+        }
+    }
+    return result;
+}
+
+void NeighborMasks::update(const OccupancyGrid& grid, int x, int y) {
+    if (!masks_) return;
+    if (masks_.use_count() > 1) {
+        masks_ = std::make_shared<std::vector<uint8_t>>(*masks_);
+    }
+    key_ = GridStorageKey(grid); // set_blocked may have copied the grid storage
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            if (grid.in_bounds(x + dx, y + dy)) {
+                size_t i = grid.index(x + dx, y + dy);
+                (*masks_)[i] = cell_mask(grid, i);
+            }
+        }
+    }
+}
+
+uint8_t NeighborMasks::adjacent_mask(int prev_dx, int prev_dy, int next_dx, int next_dy) {
+    return table().adjacent[(prev_dy + 1) * 3 + prev_dx + 1][(next_dy + 1) * 3 + next_dx + 1];
+}
+
+uint8_t NeighborMasks::adjacent_mask_4(int prev_dx, int prev_dy, int next_dx, int next_dy) {
+    return table().adjacent_4[(prev_dy + 1) * 3 + prev_dx + 1][(next_dy + 1) * 3 + next_dx + 1];
+}
+
+int NeighborMasks::nth_direction(uint8_t mask, int k) {
+    return table().nth[mask][k];
+}
+
+int NeighborMasks::count(uint8_t mask) {
+    return __builtin_popcount(mask);
+}
@@ -0,0 +1,49 @@
+#ifndef NEIGHBORS_H
+#define NEIGHBORS_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "grid.h"
+
+// Las 8 direcciones (cardinales e intercardinales), el bit d de una mascara es NEIGHBOR_OFFSETS[d]
+extern const int NEIGHBOR_OFFSETS[8][2];
+
+//Mascara de 8 bits por celda con los vecinos libres, precalculada una vez por grid.
+// Junto con adjacent_mask permite elegir un movimiento valido de un punto del camino
+// con un solo numero aleatorio, sin reintentos. Usa un byte por celda con borde
+class NeighborMasks {
+public:
+    NeighborMasks() {}
+
+    static NeighborMasks build(const OccupancyGrid& grid);
+
+    bool empty() const { return !masks_; }
+    // Built (or kept up to date with update) for this grid's storage, not just one of the same size
+    bool matches(const OccupancyGrid& grid) const { return masks_ && key_.matches(grid); }
+
+    // Bit d set if the cell at offset NEIGHBOR_OFFSETS[d] of padded cell i is free
+    uint8_t free_mask(size_t i) const { return (*masks_)[i]; }
+
+    // Recomputes the masks around (x, y) after grid.set_blocked(x, y, ...), copies them first if shared
+    void update(const OccupancyGrid& grid, int x, int y);
+
+    size_t memory_bytes() const { return masks_ ? masks_->size() : 0; }
+
+    // Neighbours of a point adjacent (Chebyshev <= 1) to both prev and next,
+    // given as offsets from the point in [-1, 1]
+    static uint8_t adjacent_mask(int prev_dx, int prev_dy, int next_dx, int next_dy);
+    // Same with 4-connectivity (Manhattan <= 1), the point itself may still move diagonally
+    static uint8_t adjacent_mask_4(int prev_dx, int prev_dy, int next_dx, int next_dy);
+
+    // Direction of the k-th set bit of mask, k < popcount(mask)
+    static int nth_direction(uint8_t mask, int k);
+    static int count(uint8_t mask);
+
+private:
+    std::shared_ptr<std::vector<uint8_t>> masks_; // shared between copies of the instance
+    GridStorageKey key_; // grid the masks describe
+};
+
+#endif // NEIGHBORS_H
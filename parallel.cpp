@@ -0,0 +1,100 @@
+#include "parallel.h"
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <memory>
+
+namespace {
+
+// Rango de tareas pendientes de un hilo, el dueno toma del frente y los ladrones del final
+struct WorkRange {
+    std::mutex mutex;
+    size_t begin;
+    size_t end;
+};
+
+bool take_own(WorkRange& range, size_t& task) {
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin >= range.end) return false;
+    task = range.begin++;
+    return true;
+}
+
+// Roba la mitad final del rango de otro hilo y la deja como rango propio
+bool steal(std::vector<std::unique_ptr<WorkRange>>& ranges, int worker) {
+    int n = ranges.size();
+    for (int k = 1; k < n; ++k) {
+        WorkRange& victim = *ranges[(worker + k) % n];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end) continue;
+            size_t mid = victim.begin + (victim.end - victim.begin) / 2;
+            begin = mid;
+            end = victim.end;
+            victim.end = mid;
+        }
+        std::lock_guard<std::mutex> lock(ranges[worker]->mutex);
+        ranges[worker]->begin = begin;
+        ranges[worker]->end = end;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int resolve_thread_count(int num_threads) {
+    if (num_threads > 0) return num_threads;
+    int hw = std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+void parallel_for(size_t count, int num_threads,
+                  const std::function<void(size_t task, int worker)>& task) {
+    int workers = resolve_thread_count(num_threads);
+    if ((size_t)workers > count) workers = count;
+    if (workers <= 1) { // no threads for a single worker
+        for (size_t i = 0; i < count; ++i) task(i, 0);
+        return;
+    }
+
+    std::vector<std::unique_ptr<WorkRange>> ranges;
+    for (int w = 0; w < workers; ++w) {
+        ranges.push_back(std::unique_ptr<WorkRange>(new WorkRange()));
+        ranges[w]->begin = count * w / workers;
+        ranges[w]->end = count * (w + 1) / workers;
+    }
+
+    auto worker_loop = [&](int worker) {
+        size_t i;
+        for (;;) {
+            while (take_own(*ranges[worker], i)) {
+                task(i, worker);
+            }
+            if (!steal(ranges, worker)) break; // every range is empty
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 1; w < workers; ++w) {
+        threads.push_back(std::thread(worker_loop, w));
+    }
+    worker_loop(0); // the calling thread is worker 0
+    for (auto& t : threads) t.join();
+}
+
+SpinBarrier::SpinBarrier(int num_threads)
+    : num_threads_(num_threads), waiting_(0), generation_(0) {}
+
+void SpinBarrier::wait() {
+    unsigned generation = generation_.load(std::memory_order_acquire);
+    if (waiting_.fetch_add(1, std::memory_order_acq_rel) + 1 == num_threads_) {
+        waiting_.store(0, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_acq_rel); // releases the other threads
+        return;
+    }
+    while (generation_.load(std::memory_order_acquire) == generation) {
+        std::this_thread::yield();
+    }
+}
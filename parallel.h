@@ -0,0 +1,31 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+#include <atomic>
+
+//Numero de hilos a usar, 0 = todos los nucleos disponibles
+int resolve_thread_count(int num_threads);
+
+//Ejecuta task(i) para i en [0, count) repartido en num_threads hilos.
+// Cada hilo parte con un rango contiguo de tareas y cuando se le acaba
+// le roba la mitad restante del rango a otro hilo (work-stealing).
+// task recibe el indice de la tarea y el del hilo que la ejecuta
+void parallel_for(size_t count, int num_threads,
+                  const std::function<void(size_t task, int worker)>& task);
+
+//Barrera reutilizable para un numero fijo de hilos, espera activa con yield.
+// Pensada para sincronizaciones frecuentes y cortas (intercambios entre replicas)
+class SpinBarrier {
+public:
+    explicit SpinBarrier(int num_threads);
+    void wait();
+
+private:
+    int num_threads_;
+    std::atomic<int> waiting_;
+    std::atomic<unsigned> generation_;
+};
+
+#endif // PARALLEL_H
@@ -0,0 +1,70 @@
+#include "policies.h"
+#include <limits>
+#include <cstdlib>
+#include <algorithm>
+
+//Distancia de Chebyshev de cada celda al obstaculo mas cercano (transformada de distancia
+// en dos pasadas, el borde cuenta como obstaculo) convertida en penalizacion
+void ClearanceCost::prepare(const OccupancyGrid& grid) {
+    if (penalty_ && key_.matches(grid) && prepared_radius_ == radius) return;
+
+    int stride = grid.stride();
+    size_t cells = grid.padded_cells();
+    std::vector<int> distance(cells, 0);
+    for (size_t i = 0; i < cells; ++i) {
+        distance[i] = grid.blocked_at(i) ? 0 : std::numeric_limits<int>::max() - 1;
+    }
+    // forward pass, neighbours already visited: left, and the three above
+    for (int y = 0; y < grid.rows(); ++y) {
+        for (int x = 0; x < grid.cols(); ++x) {
+            size_t i = grid.index(x, y);
+            int best = std::min(distance[i - 1], std::min(distance[i - stride - 1],
+                       std::min(distance[i - stride], distance[i - stride + 1])));
+            distance[i] = std::min(distance[i], best + 1);
+        }
+    }
+    // backward pass: right, and the three below
+    for (int y = grid.rows() - 1; y >= 0; --y) {
+        for (int x = grid.cols() - 1; x >= 0; --x) {
+            size_t i = grid.index(x, y);
+            int best = std::min(distance[i + 1], std::min(distance[i + stride - 1],
+                       std::min(distance[i + stride], distance[i + stride + 1])));
+            distance[i] = std::min(distance[i], best + 1);
+        }
+    }
+
+    std::shared_ptr<std::vector<float>> penalty = std::make_shared<std::vector<float>>(cells, 0.0f);
+    for (size_t i = 0; i < cells; ++i) {
+        if (distance[i] > 0 && distance[i] <= radius) {
+            (*penalty)[i] = (float)(radius + 1 - distance[i]) / radius; // 1 next to an obstacle
+        }
+    }
+    penalty_ = penalty;
+    stride_ = stride;
+    prepared_radius_ = radius;
+    key_ = GridStorageKey(grid);
+}
+
+//Solo las celdas a radius o menos de (x, y) pueden cambiar de penalizacion, a cada una se le busca
+// el obstaculo mas cercano en su ventana de radius celdas (el borde cuenta como obstaculo)
+void ClearanceCost::update(const OccupancyGrid& grid, int x, int y) {
+    if (!penalty_) return;
+    if (penalty_.use_count() > 1) {
+        penalty_ = std::make_shared<std::vector<float>>(*penalty_);
+    }
+    key_ = GridStorageKey(grid); // set_blocked may have copied the grid storage
+    for (int cy = std::max(0, y - radius); cy <= std::min(grid.rows() - 1, y + radius); ++cy) {
+        for (int cx = std::max(0, x - radius); cx <= std::min(grid.cols() - 1, x + radius); ++cx) {
+            int distance = grid.blocked(cx, cy) ? 0 : radius + 1;
+            for (int wy = std::max(-1, cy - radius); wy <= std::min(grid.rows(), cy + radius) && distance > 1; ++wy) {
+                for (int wx = std::max(-1, cx - radius); wx <= std::min(grid.cols(), cx + radius); ++wx) {
+                    if (grid.blocked(wx, wy)) {
+                        distance = std::min(distance, std::max(std::abs(wx - cx), std::abs(wy - cy)));
+                    }
+                }
+            }
+            (*penalty_)[grid.index(cx, cy)] = distance > 0 && distance <= radius
+                                                   ? (float)(radius + 1 - distance) / radius : 0.0f;
+        }
+    }
+}
@@ -0,0 +1,167 @@
+#ifndef POLICIES_H
+#define POLICIES_H
+
+#include <vector>
+#include <utility>
+#include <memory>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "grid.h"
+#include "neighbors.h"
+
+//Politicas de BasicSimulatedAnnealing (sim_ann.h), se eligen en tiempo de compilacion asi
+// el costo y la conectividad se inlinean en el ciclo sin condiciones en tiempo de ejecucion.
+//
+// Una politica de costo tiene:
+//   HAS_TURNS     true si el costo depende de tres puntos seguidos (turn), si no turn no se llama
+//   BATCH_KERNEL  true si evaluate_move_batch (batch.cpp) calcula el mismo delta
+//   prepare(grid) se llama una vez por instancia antes de evaluar costos
+//   update(grid, x, y) se llama despues de cambiar la celda (x, y) del grid (update_cells)
+//   segment(a, b) costo del segmento de a a b
+//   turn(a, b, c) costo del giro en b
+// Una politica de conectividad tiene:
+//   DEGREE        4 u 8, tambien se usa para la busqueda del camino inicial
+//   BATCH_KERNEL  true si el lote de batch.cpp revisa la misma adyacencia
+//   adjacent(a, b), move_mask(...) vecinos de un punto que siguen conectados a prev y next,
+//   line_steps y line_point para los atajos rectos de MOVE_SHORTCUT
+
+typedef std::pair<int, int> GridPoint;
+
+//Largo euclidiano, los puntos seguidos de un camino valido estan a 0, 1 o sqrt(2)
+struct EuclideanCost {
+    static const bool HAS_TURNS = false;
+    static const bool BATCH_KERNEL = true;
+
+    void prepare(const OccupancyGrid&) {}
+    void update(const OccupancyGrid&, int, int) {}
+
+    static double length(const GridPoint& a, const GridPoint& b) {
+        static const double LENGTHS[3] = {0.0, 1.0, 1.4142135623730951}; // sqrt(0), sqrt(1), sqrt(2)
+        int dx = std::abs(b.first - a.first);
+        int dy = std::abs(b.second - a.second);
+        if (dx <= 1 && dy <= 1) return LENGTHS[dx + dy];
+        return std::sqrt((double)(dx * dx + dy * dy)); // not neighbours, only in invalid paths
+    }
+    double segment(const GridPoint& a, const GridPoint& b) const { return length(a, b); }
+    double turn(const GridPoint&, const GridPoint&, const GridPoint&) const { return 0.0; }
+};
+
+//Distancia Manhattan, una diagonal cuesta 2
+struct ManhattanCost {
+    static const bool HAS_TURNS = false;
+    static const bool BATCH_KERNEL = false;
+
+    void prepare(const OccupancyGrid&) {}
+    void update(const OccupancyGrid&, int, int) {}
+
+    double segment(const GridPoint& a, const GridPoint& b) const {
+        return std::abs(b.first - a.first) + std::abs(b.second - a.second);
+    }
+    double turn(const GridPoint&, const GridPoint&, const GridPoint&) const { return 0.0; }
+};
+
+//Largo euclidiano con recargo cerca de obstaculos: cada segmento cuesta
+// largo * (1 + weight * promedio de la penalizacion de sus extremos). La penalizacion de una
+// celda es 1 junto a un obstaculo (o al borde) y baja linealmente hasta 0 a mas de radius celdas
+struct ClearanceCost {
+    static const bool HAS_TURNS = false;
+    static const bool BATCH_KERNEL = false;
+
+    double weight;
+    int radius;
+
+    ClearanceCost() : weight(1.0), radius(3), stride_(0), prepared_radius_(0) {}
+
+    // Distance transform, skipped if already built for this grid (same storage) and radius.
+    // Copies share the table, reset() forces a rebuild after the grid changes
+    void prepare(const OccupancyGrid& grid);
+    void reset() { penalty_.reset(); }
+    // Recomputes the cells within radius of (x, y), copies the table first if shared
+    void update(const OccupancyGrid& grid, int x, int y);
+
+    double penalty(const GridPoint& p) const {
+        return (*penalty_)[(size_t)(p.second + 1) * stride_ + (p.first + 1)];
+    }
+    double segment(const GridPoint& a, const GridPoint& b) const {
+        return EuclideanCost::length(a, b) * (1.0 + weight * 0.5 * (penalty(a) + penalty(b)));
+    }
+    double turn(const GridPoint&, const GridPoint&, const GridPoint&) const { return 0.0; }
+
+private:
+    std::shared_ptr<std::vector<float>> penalty_; // per padded cell, shared between copies
+    int stride_;
+    int prepared_radius_;
+    GridStorageKey key_; // grid the table was built for
+};
+
+//Largo euclidiano mas weight por cada giro de 45 grados (un giro de 90 cuesta 2 * weight)
+struct TurnPenaltyCost {
+    static const bool HAS_TURNS = true;
+    static const bool BATCH_KERNEL = false;
+
+    double weight;
+
+    TurnPenaltyCost() : weight(0.5) {}
+
+    void prepare(const OccupancyGrid&) {}
+    void update(const OccupancyGrid&, int, int) {}
+
+    double segment(const GridPoint& a, const GridPoint& b) const { return EuclideanCost::length(a, b); }
+    double turn(const GridPoint& a, const GridPoint& b, const GridPoint& c) const {
+        int from = heading(b.first - a.first, b.second - a.second);
+        int to = heading(c.first - b.first, c.second - b.second);
+        if (from < 0 || to < 0) return 0.0; // repeated point, no direction
+        int steps = std::abs(from - to);
+        return weight * std::min(steps, 8 - steps);
+    }
+
+    // 0..7 around the compass, -1 for no movement
+    static int heading(int dx, int dy) {
+        static const int HEADINGS[3][3] = {{7, 0, 1}, {6, -1, 2}, {5, 4, 3}}; // [dy + 1][dx + 1]
+        return HEADINGS[(dy > 0) - (dy < 0) + 1][(dx > 0) - (dx < 0) + 1];
+    }
+};
+
+//Conectividad 8: puntos seguidos a distancia de Chebyshev <= 1
+struct EightConnected {
+    static const int DEGREE = 8;
+    static const bool BATCH_KERNEL = true;
+
+    static bool adjacent(const GridPoint& a, const GridPoint& b) {
+        return std::max(std::abs(a.first - b.first), std::abs(a.second - b.second)) <= 1;
+    }
+    static uint8_t move_mask(int prev_dx, int prev_dy, int next_dx, int next_dy) {
+        return NeighborMasks::adjacent_mask(prev_dx, prev_dy, next_dx, next_dy);
+    }
+    // Straight run from a to a + (dx, dy), one step per Chebyshev unit
+    static int line_steps(int dx, int dy) { return std::max(std::abs(dx), std::abs(dy)); }
+    static GridPoint line_point(const GridPoint& a, int dx, int dy, int steps, int k) {
+        return {a.first + (int) std::lround((double) k * dx / steps),
+                a.second + (int) std::lround((double) k * dy / steps)};
+    }
+};
+
+//Conectividad 4: puntos seguidos a distancia Manhattan <= 1
+struct FourConnected {
+    static const int DEGREE = 4;
+    static const bool BATCH_KERNEL = false;
+
+    static bool adjacent(const GridPoint& a, const GridPoint& b) {
+        return std::abs(a.first - b.first) + std::abs(a.second - b.second) <= 1;
+    }
+    static uint8_t move_mask(int prev_dx, int prev_dy, int next_dx, int next_dy) {
+        return NeighborMasks::adjacent_mask_4(prev_dx, prev_dy, next_dx, next_dy);
+    }
+    // Staircase run, each step moves along x or along y, whichever stays closer to the line
+    static int line_steps(int dx, int dy) { return std::abs(dx) + std::abs(dy); }
+    static GridPoint line_point(const GridPoint& a, int dx, int dy, int steps, int k) {
+        int along_x = (int)(((long long) 2 * k * std::abs(dx) + steps) / (2 * steps)); // round(k * |dx| / steps)
+        int sx = (dx > 0) - (dx < 0);
+        int sy = (dy > 0) - (dy < 0);
+        return {a.first + sx * along_x, a.second + sy * (k - along_x)};
+    }
+};
+
+#endif // POLICIES_H
@@ -0,0 +1,24 @@
+#include <iostream>
+#include <string>
+#include "instance.h"
+
+// Conversion de instancias .prob al formato binario que se carga con mmap
+// Uso: ./prob2bin entrada.prob salida.bin
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " input.prob output.bin" << std::endl;
+        return 1;
+    }
+
+    GridInstance grid_instance;
+    if (!parse_instance(argv[1], grid_instance, OccupancyGrid::BITMAP)) {
+        return 1;
+    }
+    if (!write_binary_instance(argv[2], grid_instance)) {
+        std::cerr << "could not write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << argv[2] << " (" << grid_instance.grid.memory_bytes() << " bytes of grid)" << std::endl;
+    return 0;
+}
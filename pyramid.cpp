@@ -0,0 +1,223 @@
+#include "pyramid.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace {
+
+// Budget of a level once the deadline has passed, it stops at the first clock check of run_anytime
+const double MIN_LEVEL_BUDGET_MS = 1e-3;
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool blocked_or_outside(const OccupancyGrid& grid, const std::pair<int, int>& p) {
+    return !grid.in_bounds(p.first, p.second) || grid.blocked(p.first, p.second);
+}
+
+} // namespace
+
+OccupancyGrid coarsen_grid(const OccupancyGrid& grid) {
+    int rows = (grid.rows() + 1) / 2;
+    int cols = (grid.cols() + 1) / 2;
+    std::vector<unsigned char> cells((size_t) rows * cols, 0);
+    for (int y = 0; y < grid.rows(); ++y) {
+        for (int x = 0; x < grid.cols(); ++x) {
+            if (grid.blocked(x, y)) cells[(size_t)(y / 2) * cols + x / 2] = 1;
+        }
+    }
+    return OccupancyGrid(rows, cols, cells, grid.mode());
+}
+
+GridPyramid GridPyramid::build(const GridInstance& instance, int min_side, int max_levels) {
+    GridPyramid pyramid;
+    GridInstance level = instance;
+    if (!level.masks.matches(level.grid)) level.masks = NeighborMasks::build(level.grid);
+    pyramid.levels_.push_back(level);
+
+    while ((int) pyramid.levels_.size() < max_levels && std::max(level.rows, level.cols) > min_side) {
+        level.grid = coarsen_grid(level.grid);
+        level.rows = level.grid.rows();
+        level.cols = level.grid.cols();
+        level.start = to_level(instance.start, (int) pyramid.levels_.size());
+        level.end = to_level(instance.end, (int) pyramid.levels_.size());
+        level.masks = NeighborMasks::build(level.grid);
+        pyramid.levels_.push_back(level);
+    }
+    return pyramid;
+}
+
+size_t GridPyramid::memory_bytes() const {
+    size_t bytes = 0;
+    for (size_t k = 1; k < levels_.size(); ++k) { // level 0 belongs to the instance
+        bytes += levels_[k].grid.memory_bytes() + levels_[k].masks.memory_bytes();
+    }
+    return bytes;
+}
+
+//Constructor, los parametros de SA son los de cada nivel
+template <class Cost, class Connectivity>
+BasicPyramidAnnealing<Cost, Connectivity>::BasicPyramidAnnealing(double T, double cooling_rate, double temp_threshold,
+                                                                 const GridPyramid& pyramid)
+    : pyramid(&pyramid), T(T), cooling_rate(cooling_rate), temp_threshold(temp_threshold),
+      corridor_radius(2), seed_method(SEED_ASTAR), search_context(nullptr), random_seed(0),
+      best_cost(std::numeric_limits<double>::max()), top_level(-1) {}
+
+//Camino de start a end (celdas del nivel 0), retorna false si no existe.
+// El nivel de arriba es el mas grueso donde los bloques de start y end estan libres, si el grid
+// grueso cerro todos los pasos se baja un nivel. Si la busqueda en el corredor falla (puede pasar
+// cerca de start y end) se busca en todo el nivel
+template <class Cost, class Connectivity>
+bool BasicPyramidAnnealing<Cost, Connectivity>::run(std::pair<int, int> start, std::pair<int, int> end) {
+    static thread_local SearchContext thread_context;
+    SearchContext& context = search_context ? *search_context : thread_context;
+    Best_sol.clear();
+    best_cost = std::numeric_limits<double>::max();
+    top_level = -1;
+    level_stats.clear();
+    if (annealers.size() < (size_t) pyramid->levels()) annealers.resize(pyramid->levels());
+    if (blocked_or_outside(pyramid->level(0).grid, start) || blocked_or_outside(pyramid->level(0).grid, end)) {
+        return false;
+    }
+
+    int level = pyramid->levels() - 1;
+    while (level > 0 && (pyramid->level(level).grid.blocked(start.first >> level, start.second >> level) ||
+                         pyramid->level(level).grid.blocked(end.first >> level, end.second >> level))) {
+        level--;
+    }
+
+    auto run_start = std::chrono::steady_clock::now();
+    std::vector<std::pair<int, int>> path;
+    std::vector<std::pair<int, int>> coarse_path;
+    PyramidLevelStats stats = {level, 0, false, 0.0, 0.0, 0, 0, 0.0, 0.0};
+    context.end_corridor();
+    for (; level >= 0; --level) {
+        auto search_start = std::chrono::steady_clock::now();
+        bool found = find_path(pyramid->level(level).grid, GridPyramid::to_level(start, level),
+                               GridPyramid::to_level(end, level), seed_method, context, path, Connectivity::DEGREE);
+        stats.search_ms += ms_since(search_start); // failed coarser levels included
+        if (found) break;
+    }
+    if (level < 0) return false;
+    top_level = level;
+
+    for (;;) {
+        stats.level = level;
+        std::pair<int, int> level_start = GridPyramid::to_level(start, level);
+        std::pair<int, int> level_end = GridPyramid::to_level(end, level);
+        if (level < top_level) { // search inside the corridor around the projection of coarse_path
+            auto search_start = std::chrono::steady_clock::now();
+            const OccupancyGrid& grid = pyramid->level(level).grid;
+            mark_corridor(context, coarse_path, level, level_start, level_end, stats.corridor_cells);
+            bool found = find_path(grid, level_start, level_end, SEED_ASTAR, context, path, Connectivity::DEGREE);
+            context.end_corridor();
+            if (!found) {
+                stats.corridor_fallback = true;
+                found = find_path(grid, level_start, level_end, SEED_ASTAR, context, path, Connectivity::DEGREE);
+            }
+            stats.search_ms = ms_since(search_start);
+            if (!found) return false; // the coarse levels only remove free cells, not reached
+        }
+
+        // One deadline for the whole run, searches included. The path doubles its points at each finer
+        // level, so level k gets 2^-k parts of what is left: left / (2^(level+1) - 1), all of it at
+        // level 0. What a coarse level does not use goes to the finer ones
+        RunLimits level_limits = limits;
+        if (limits.time_budget_ms > 0.0) {
+            double left_ms = limits.time_budget_ms - ms_since(run_start);
+            level_limits.time_budget_ms = std::max(left_ms / ((2 << level) - 1), MIN_LEVEL_BUDGET_MS);
+        }
+        auto anneal_start = std::chrono::steady_clock::now();
+        Annealer& sa = anneal(level, level_start, level_end, path, level_limits, stats.seed_cost);
+        stats.anneal_ms = ms_since(anneal_start);
+        stats.iterations = sa.iterations;
+        stats.path_points = path.size();
+        stats.cost = sa.evaluate_cost(path);
+        level_stats.push_back(stats);
+
+        if (level == 0) {
+            best_cost = stats.cost;
+            break;
+        }
+        coarse_path.swap(path);
+        level--;
+        stats = PyramidLevelStats{level, 0, false, 0.0, 0.0, 0, 0, 0.0, 0.0};
+    }
+    Best_sol.swap(path);
+    return true;
+}
+
+//Corredor del nivel level: los bloques de coarse_path (nivel level + 1) en celdas de level,
+// con corridor_radius celdas alrededor, mas start y end. Cuesta lo que mide el camino, no el grid
+template <class Cost, class Connectivity>
+void BasicPyramidAnnealing<Cost, Connectivity>::mark_corridor(SearchContext& context,
+                                                              const std::vector<std::pair<int, int>>& coarse_path,
+                                                              int level, std::pair<int, int> start,
+                                                              std::pair<int, int> end, size_t& cells) {
+    const OccupancyGrid& grid = pyramid->level(level).grid;
+    context.begin_corridor(grid.padded_cells());
+    cells = 0;
+    for (const auto& block : coarse_path) {
+        int x0 = std::max(0, 2 * block.first - corridor_radius);
+        int x1 = std::min(grid.cols() - 1, 2 * block.first + 1 + corridor_radius);
+        int y0 = std::max(0, 2 * block.second - corridor_radius);
+        int y1 = std::min(grid.rows() - 1, 2 * block.second + 1 + corridor_radius);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                size_t i = grid.index(x, y);
+                if (!context.in_corridor(i)) {
+                    context.add_to_corridor(i);
+                    cells++;
+                }
+            }
+        }
+    }
+    for (size_t i : {grid.index(start.first, start.second), grid.index(end.first, end.second)}) {
+        if (!context.in_corridor(i)) {
+            context.add_to_corridor(i);
+            cells++;
+        }
+    }
+}
+
+//SA del nivel level desde path, path queda con el mejor camino y seed_cost con el costo de entrada.
+// El Annealer de cada nivel se reutiliza entre corridas (con las tablas de la politica de costo ya preparadas)
+template <class Cost, class Connectivity>
+typename BasicPyramidAnnealing<Cost, Connectivity>::Annealer&
+BasicPyramidAnnealing<Cost, Connectivity>::anneal(int level, std::pair<int, int> start, std::pair<int, int> end,
+                                                  std::vector<std::pair<int, int>>& path,
+                                                  const RunLimits& level_limits, double& seed_cost) {
+    GridInstance instance = pyramid->level(level); // shares the grid and the masks
+    instance.start = start;
+    instance.end = end;
+
+    std::unique_ptr<Annealer>& annealer = annealers[level];
+    if (!annealer) {
+        annealer.reset(new Annealer(T, cooling_rate, temp_threshold, instance, path));
+    } else {
+        annealer->init(T, cooling_rate, temp_threshold, instance);
+        annealer->telemetry = Telemetry();
+        annealer->Current_sol = path;
+        annealer->Best_sol = path;
+    }
+    Annealer& sa = *annealer;
+    sa.set_random_seed(random_seed + level);
+    sa.seed_method = seed_method;
+    sa.search_context = search_context;
+    if (configure) configure(sa, level);
+
+    seed_cost = sa.evaluate_cost(path);
+    sa.run_anytime(level_limits);
+    path = sa.Best_sol;
+    return sa;
+}
+
+template class BasicPyramidAnnealing<EuclideanCost, EightConnected>;
+template class BasicPyramidAnnealing<EuclideanCost, FourConnected>;
+template class BasicPyramidAnnealing<ManhattanCost, EightConnected>;
+template class BasicPyramidAnnealing<ManhattanCost, FourConnected>;
+template class BasicPyramidAnnealing<ClearanceCost, EightConnected>;
+template class BasicPyramidAnnealing<ClearanceCost, FourConnected>;
+template class BasicPyramidAnnealing<TurnPenaltyCost, EightConnected>;
+template class BasicPyramidAnnealing<TurnPenaltyCost, FourConnected>;
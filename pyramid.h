@@ -0,0 +1,101 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <vector>
+#include <utility>
+#include <memory>
+#include <cstddef>
+#include "sim_ann.h"
+
+//Grid reducido a la mitad por lado: un bloque de 2x2 celdas esta bloqueado si alguna lo esta
+OccupancyGrid coarsen_grid(const OccupancyGrid& grid);
+
+//Piramide de grids cada vez mas gruesos, el nivel 0 es el grid original y el nivel k tiene
+// bloques de 2^k x 2^k celdas. Cada nivel tiene sus mascaras de vecinos, se construye una vez por mapa
+class GridPyramid {
+public:
+    GridPyramid() {}
+
+    // Halves the grid of instance until its longest side is at most min_side, or max_levels levels.
+    // Level 0 shares the grid and the masks of instance (the masks are built if missing)
+    static GridPyramid build(const GridInstance& instance, int min_side = 64, int max_levels = 16);
+
+    int levels() const { return (int) levels_.size(); }
+    const GridInstance& level(int k) const { return levels_[k]; } // start and end of the instance in level k cells
+    size_t memory_bytes() const;
+
+    // Cell of level k that contains cell p of level 0
+    static std::pair<int, int> to_level(const std::pair<int, int>& p, int k) {
+        return {p.first >> k, p.second >> k};
+    }
+
+private:
+    std::vector<GridInstance> levels_;
+};
+
+//Resultado de un nivel de BasicPyramidAnnealing::run
+struct PyramidLevelStats {
+    int level;
+    size_t corridor_cells; // cells marked around the projected path, 0 at the top level
+    bool corridor_fallback; // no path inside the corridor, the whole level was searched
+    double search_ms;
+    double anneal_ms;
+    long iterations;
+    size_t path_points;
+    double seed_cost; // cost of the searched path, before annealing, in cells of this level
+    double cost;      // cost of the annealed path
+};
+
+//Annealing de grueso a fino: busca y templa el camino en el nivel mas grueso de la piramide, luego
+// lo proyecta al nivel siguiente, busca con A* solo dentro de un corredor alrededor de la proyeccion
+// y vuelve a templar, hasta el nivel 0. Asi el trabajo de cada consulta depende del largo del
+// camino y no del area del mapa. Con Cost y Connectivity igual que BasicSimulatedAnnealing
+template <class Cost, class Connectivity>
+class BasicPyramidAnnealing {
+public: // all public for easy access
+    typedef BasicSimulatedAnnealing<Cost, Connectivity> Annealer;
+
+    //Parametros
+    const GridPyramid* pyramid;
+    double T;
+    double cooling_rate;
+    double temp_threshold;
+    RunLimits limits;        // time_budget_ms for the whole run, split over the levels left; the rest per level
+    int corridor_radius;     // cells of the finer level added around each projected block
+    SeedMethod seed_method;  // search at the top level, the corridor searches always use A*
+    SearchContext* search_context; // nullptr = one per thread
+    std::function<void(Annealer& sa, int level)> configure; // optional, called before each annealing run
+    unsigned random_seed;    // the annealer of level k uses random_seed + k
+
+    //Resultado
+    std::vector<std::pair<int, int>> Best_sol; // level 0 path, empty if there is none
+    double best_cost;
+    int top_level; // level where the path was first found
+    std::vector<PyramidLevelStats> level_stats; // from the top level down to level 0
+
+    std::vector<std::unique_ptr<Annealer>> annealers; // one per level, reused by every run
+
+    //Constructor
+    BasicPyramidAnnealing(double T, double cooling_rate, double temp_threshold, const GridPyramid& pyramid);
+
+    //Funciones
+    bool run(std::pair<int, int> start, std::pair<int, int> end);
+    void mark_corridor(SearchContext& context, const std::vector<std::pair<int, int>>& coarse_path, int level,
+                       std::pair<int, int> start, std::pair<int, int> end, size_t& cells);
+    Annealer& anneal(int level, std::pair<int, int> start, std::pair<int, int> end,
+                     std::vector<std::pair<int, int>>& path, const RunLimits& level_limits, double& seed_cost);
+};
+
+typedef BasicPyramidAnnealing<EuclideanCost, EightConnected> PyramidAnnealing;
+
+// Instantiated in pyramid.cpp
+extern template class BasicPyramidAnnealing<EuclideanCost, EightConnected>;
+extern template class BasicPyramidAnnealing<EuclideanCost, FourConnected>;
+extern template class BasicPyramidAnnealing<ManhattanCost, EightConnected>;
+extern template class BasicPyramidAnnealing<ManhattanCost, FourConnected>;
+extern template class BasicPyramidAnnealing<ClearanceCost, EightConnected>;
+extern template class BasicPyramidAnnealing<ClearanceCost, FourConnected>;
+extern template class BasicPyramidAnnealing<TurnPenaltyCost, EightConnected>;
+extern template class BasicPyramidAnnealing<TurnPenaltyCost, FourConnected>;
+
+#endif // PYRAMID_H
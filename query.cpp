@@ -0,0 +1,133 @@
+#include "query.h"
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+bool parse_query(const std::string& line, long id, RouteQuery& query) {
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') return false;
+
+    query = RouteQuery();
+    query.id = id;
+    query.seed = (unsigned) id;
+    query.budget_ms = 0.0;
+
+    std::istringstream ss(line);
+    if (!(ss >> query.start.first >> query.start.second >> query.end.first >> query.end.second)) {
+        query.error = "expected: sx sy ex ey [seed [budget_ms]]";
+        return true;
+    }
+    long long seed;
+    if (ss >> seed) {
+        if (seed < 0 || seed > 0xffffffffLL) {
+            query.error = "seed out of range";
+            return true;
+        }
+        query.seed = (unsigned) seed;
+        if (ss >> query.budget_ms) {
+            if (query.budget_ms < 0.0) query.error = "negative budget";
+        }
+    }
+    ss.clear();
+    std::string rest;
+    if (ss >> rest) query.error = "unexpected value " + rest;
+    return true;
+}
+
+void validate_query(const OccupancyGrid& grid, RouteQuery& query) {
+    if (!query.error.empty()) return;
+    if (!grid.in_bounds(query.start.first, query.start.second)) {
+        query.error = "start out of the grid";
+    } else if (!grid.in_bounds(query.end.first, query.end.second)) {
+        query.error = "end out of the grid";
+    } else if (grid.blocked(query.start.first, query.start.second)) {
+        query.error = "start on an obstacle";
+    } else if (grid.blocked(query.end.first, query.end.second)) {
+        query.error = "end on an obstacle";
+    }
+}
+
+bool read_query_block(std::istream& in, size_t max_queries, long& line_number, std::vector<RouteQuery>& block) {
+    block.clear();
+    std::string line;
+    RouteQuery query;
+    while (block.size() < max_queries) {
+        if (!block.empty() && in.rdbuf()->in_avail() <= 0) break; // the next read would wait for input
+        if (!std::getline(in, line)) break;
+        line_number++;
+        if (parse_query(line, line_number, query)) block.push_back(query);
+    }
+    return !block.empty();
+}
+
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char) c < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", (unsigned) c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// The error may quote the input line (parse_query), it is the only escaped field
+void write_answer(std::ostream& out, const RouteQuery& query, const RouteAnswer& answer, bool chain_codes) {
+    out << "{\"id\":" << query.id
+        << ",\"start\":[" << query.start.first << "," << query.start.second << "]"
+        << ",\"end\":[" << query.end.first << "," << query.end.second << "]"
+        << ",\"seed\":" << query.seed;
+    if (!answer.ok) {
+        out << ",\"status\":\"error\",\"error\":\"" << json_escape(answer.error) << "\"}\n";
+        return;
+    }
+    out << ",\"status\":\"ok\""
+        << std::fixed << std::setprecision(6)
+        << ",\"initial_cost\":" << answer.initial_cost
+        << ",\"cost\":" << answer.cost
+        << ",\"iterations\":" << answer.iterations
+        << ",\"stop\":\"" << stop_reason_name(answer.stop_reason) << "\""
+        << std::setprecision(3)
+        << ",\"search_ms\":" << answer.search_ms
+        << ",\"anneal_ms\":" << answer.anneal_ms;
+    if (chain_codes) {
+        std::string codes(answer.path.steps(), '0');
+        for (size_t k = 0; k < codes.size(); ++k) codes[k] = (char)('0' + answer.path.direction(k));
+        out << ",\"path_start\":[" << answer.path.front().first << "," << answer.path.front().second << "]"
+            << ",\"path_codes\":\"" << codes << "\"}\n";
+        return;
+    }
+    out << ",\"path\":[";
+    std::pair<int, int> p = answer.path.front();
+    for (size_t k = 0; k <= answer.path.steps(); ++k) {
+        if (k) {
+            int d = answer.path.direction(k - 1);
+            p.first += NEIGHBOR_OFFSETS[d][0];
+            p.second += NEIGHBOR_OFFSETS[d][1];
+        }
+        out << (k ? "," : "") << "[" << p.first << "," << p.second << "]";
+    }
+    out << "]}\n";
+}
+
+void write_agent_answer(std::ostream& out, const RouteQuery& query, const std::vector<std::pair<int, int>>& path,
+                        int arrival, double cost) {
+    out << "{\"id\":" << query.id
+        << ",\"start\":[" << query.start.first << "," << query.start.second << "]"
+        << ",\"end\":[" << query.end.first << "," << query.end.second << "]"
+        << ",\"status\":\"ok\""
+        << std::fixed << std::setprecision(6) << ",\"cost\":" << cost
+        << ",\"arrival\":" << arrival
+        << ",\"path\":[";
+    for (int t = 0; t <= arrival; ++t) {
+        out << (t ? "," : "") << "[" << path[t].first << "," << path[t].second << "]";
+    }
+    out << "]}\n";
+}
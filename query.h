@@ -0,0 +1,64 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <istream>
+#include <ostream>
+#include "sim_ann.h"
+#include "chain.h"
+
+//Consulta del modo batch (./main --queries), una por linea de texto:
+//   sx sy ex ey [seed [budget_ms]]
+// Las lineas vacias y las que empiezan con # se ignoran
+struct RouteQuery {
+    long id; // line number in the input, repeated in the answer
+    std::pair<int, int> start;
+    std::pair<int, int> end;
+    unsigned seed;    // omitted = the line number, so the same input gives the same answers
+    double budget_ms; // omitted or 0 = TIME_BUDGET_MS of main
+    std::string error; // not empty if the line or the cells are not valid, no search is done
+};
+
+//Respuesta de una consulta
+struct RouteAnswer {
+    bool ok;
+    std::string error;
+    ChainPath path; // best path, start and end included, a block of long answers stays small
+    double initial_cost; // cost of the searched seed path
+    double cost;
+    long iterations;
+    StopReason stop_reason;
+    double search_ms;
+    double anneal_ms;
+
+    RouteAnswer() : ok(false), initial_cost(0.0), cost(0.0), iterations(0),
+                    stop_reason(STOP_TEMPERATURE), search_ms(0.0), anneal_ms(0.0) {}
+};
+
+//Lee la consulta de una linea, retorna false si la linea no tiene consulta (vacia o comentario).
+// Una linea mal formada retorna true con query.error
+bool parse_query(const std::string& line, long id, RouteQuery& query);
+
+//Revisa que inicio y final esten dentro del grid y en celdas libres, si no deja query.error
+void validate_query(const OccupancyGrid& grid, RouteQuery& query);
+
+//Lee hasta max_queries consultas en block. Se detiene antes si ya leyo alguna y no quedan datos
+// en el buffer de in, asi una consulta escrita a mano en stdin se responde sin esperar el bloque.
+// line_number cuenta las lineas leidas entre llamadas. Retorna false al final de la entrada sin consultas
+bool read_query_block(std::istream& in, size_t max_queries, long& line_number, std::vector<RouteQuery>& block);
+
+//Texto para ir entre comillas en JSON: escapa comillas, barras invertidas y los caracteres de control
+std::string json_escape(const std::string& text);
+
+//Escribe la respuesta como una linea de JSON (NDJSON). El camino va como lista de puntos, o con
+// chain_codes como su primer punto y un digito por paso (el indice en NEIGHBOR_OFFSETS)
+void write_answer(std::ostream& out, const RouteQuery& query, const RouteAnswer& answer, bool chain_codes = false);
+
+//Escribe el camino de un agente del modo de varios agentes (./main --agents) como una linea de JSON.
+// El punto t del camino es la celda en el tiempo t (los puntos repetidos son esperas), hasta arrival
+void write_agent_answer(std::ostream& out, const RouteQuery& query, const std::vector<std::pair<int, int>>& path,
+                        int arrival, double cost);
+
+#endif // QUERY_H
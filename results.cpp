@@ -0,0 +1,160 @@
+#include "results.h"
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
+
+void RunningStats::add(double x) {
+    count_++;
+    double delta = x - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (x - mean_);
+    values_.push_back(x);
+}
+
+double RunningStats::stddev() const {
+    return count_ > 1 ? std::sqrt(m2_ / (count_ - 1)) : 0.0;
+}
+
+double RunningStats::percentile(double p) const {
+    if (values_.empty()) return 0.0;
+    std::vector<double> values = values_;
+    long rank = (long) std::ceil(p / 100.0 * values.size()); // nearest rank, 1-based
+    size_t k = (size_t) std::min((long) values.size(), std::max(1L, rank)) - 1;
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+namespace {
+
+// One row of the runs file, false if a field is missing or does not parse
+bool parse_record(const std::string& line, RunRecord& record) {
+    std::istringstream ss(line);
+    std::string field[10];
+    for (int f = 0; f < 10; ++f) {
+        if (!std::getline(ss, field[f], ',') || field[f].empty()) return false;
+    }
+    try {
+        record.instance_name = field[0];
+        record.run = std::stoi(field[1]);
+        record.seed = (unsigned) std::stoul(field[2]);
+        record.initial_cost = std::stod(field[3]);
+        record.best_cost = std::stod(field[4]);
+        record.iterations = std::stol(field[5]);
+        record.execution_time_ms = std::stod(field[6]);
+        record.schedule = field[7];
+        record.final_temperature = std::stod(field[8]);
+        record.reheats = std::stoi(field[9]);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+void add_to_summary(InstanceSummary& summary, const RunRecord& record) {
+    summary.initial_cost.add(record.initial_cost);
+    summary.best_cost.add(record.best_cost);
+    summary.cost_difference.add(record.initial_cost - record.best_cost);
+    summary.iterations.add((double) record.iterations);
+    summary.execution_time_ms.add(record.execution_time_ms);
+    summary.final_temperature.add(record.final_temperature);
+    summary.reheats.add((double) record.reheats);
+}
+
+SummaryKey summary_key(const RunRecord& record) {
+    return SummaryKey(record.instance_name, record.schedule);
+}
+
+} // namespace
+
+const char* ResultsWriter::header() {
+    return "instance_name,run,seed,initial_cost,best_cost,iterations,execution_time_ms,schedule,final_temperature,reheats";
+}
+
+ResultsWriter::ResultsWriter(const std::string& path, bool resume) : open_(false), closing_(false) {
+    std::vector<RunRecord> kept; // in file order
+    size_t complete = 0; // bytes of the complete lines of the previous file
+    if (resume) {
+        std::ifstream previous(path);
+        std::string content((std::istreambuf_iterator<char>(previous)), std::istreambuf_iterator<char>());
+        complete = content.find_last_of('\n') + 1; // 0 without any newline
+        std::istringstream lines(content.substr(0, complete));
+        std::string line;
+        RunRecord record;
+        while (std::getline(lines, line)) {
+            if (line == header() || !parse_record(line, record)) continue;
+            if (previous_.insert({{summary_key(record), record.run}, record}).second) kept.push_back(record);
+        }
+        // only a cut last line is dropped, the completed runs are never rewritten
+        if (complete < content.size() && truncate(path.c_str(), (off_t) complete) != 0) return;
+    }
+
+    file_.open(path, resume ? std::ios::app : std::ios::trunc);
+    if (!file_.is_open()) return;
+    open_ = true;
+    if (complete == 0) file_ << header() << "\n";
+    for (const RunRecord& record : kept) {
+        add_to_summary(summaries_[summary_key(record)], record);
+    }
+    file_.flush();
+    thread_ = std::thread(&ResultsWriter::writer_loop, this);
+}
+
+ResultsWriter::~ResultsWriter() {
+    close();
+}
+
+bool ResultsWriter::completed(const std::string& instance_name, const std::string& schedule, int run,
+                              RunRecord& record) const {
+    auto it = previous_.find({SummaryKey(instance_name, schedule), run});
+    if (it == previous_.end()) return false;
+    record = it->second;
+    return true;
+}
+
+void ResultsWriter::push(const RunRecord& record) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(record);
+    }
+    ready_.notify_one();
+}
+
+void ResultsWriter::close() {
+    if (!thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    ready_.notify_one();
+    thread_.join();
+    file_.close();
+}
+
+//Hilo escritor: toma toda la cola de una vez, la escribe y vacia el archivo antes de esperar de nuevo
+void ResultsWriter::writer_loop() {
+    std::vector<RunRecord> batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] { return closing_ || !queue_.empty(); });
+            if (queue_.empty()) return; // closing and nothing left
+            batch.swap(queue_);
+        }
+        for (const RunRecord& record : batch) {
+            write_record(record);
+            add_to_summary(summaries_[summary_key(record)], record);
+        }
+        batch.clear();
+        file_.flush();
+    }
+}
+
+void ResultsWriter::write_record(const RunRecord& record) {
+    file_ << record.instance_name << "," << record.run << "," << record.seed << ","
+          << std::fixed << std::setprecision(6) << record.initial_cost << "," << record.best_cost << ","
+          << record.iterations << "," << std::setprecision(4) << record.execution_time_ms << ","
+          << record.schedule << "," << std::setprecision(6) << record.final_temperature << "," << record.reheats << "\n";
+}
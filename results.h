@@ -0,0 +1,102 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//Resultado de una simulacion, una fila del archivo de corridas
+struct RunRecord {
+    std::string instance_name;
+    int run; // index of the simulation inside its instance
+    unsigned seed;
+    double initial_cost;
+    double best_cost;
+    long iterations;
+    double execution_time_ms;
+    std::string schedule; // cooling_kind_name of the run, or "tempering"
+    double final_temperature;
+    int reheats;
+};
+
+//Estadisticas de una muestra que llega de a un valor: media y desviacion estandar con Welford,
+// los valores se guardan para los percentiles exactos (nearest rank) al final
+class RunningStats {
+public:
+    RunningStats() : count_(0), mean_(0.0), m2_(0.0) {}
+
+    void add(double x);
+    long count() const { return count_; }
+    double mean() const { return mean_; }
+    double stddev() const; // sample standard deviation, 0 with less than two values
+    double percentile(double p) const; // p in [0, 100], 50 = median
+
+private:
+    long count_;
+    double mean_;
+    double m2_;
+    std::vector<double> values_;
+};
+
+//Resumen de las corridas de una instancia
+struct InstanceSummary {
+    RunningStats initial_cost;
+    RunningStats best_cost;
+    RunningStats cost_difference;
+    RunningStats iterations;
+    RunningStats execution_time_ms;
+    RunningStats final_temperature;
+    RunningStats reheats;
+};
+
+typedef std::pair<std::string, std::string> SummaryKey; // instance name and schedule
+
+//Escritor asincrono del archivo de corridas (CSV, una fila por simulacion). push solo encola el
+// registro, un hilo propio lo escribe y actualiza los resumenes, y vacia el archivo cada vez que
+// la cola queda vacia. Asi el disco no entra en el tiempo de las simulaciones y una corrida
+// interrumpida deja en el archivo todo lo terminado hasta ese momento.
+// Con resume las filas completas de un archivo anterior se conservan: el archivo se corta en su
+// ultima linea completa (una linea cortada al final se descarta) y se sigue en modo append, sin
+// reescribir nada, y completed() dice que simulaciones no hay que repetir. Las filas y los resumenes
+// son por instancia y esquema de enfriamiento, un mismo archivo puede juntar barridos con esquemas distintos
+class ResultsWriter {
+public:
+    ResultsWriter(const std::string& path, bool resume);
+    ~ResultsWriter(); // close()
+
+    bool is_open() const { return open_; }
+    size_t resumed() const { return previous_.size(); }
+
+    // Record of an earlier sweep for this simulation, only with resume
+    bool completed(const std::string& instance_name, const std::string& schedule, int run, RunRecord& record) const;
+
+    void push(const RunRecord& record); // thread safe, does not wait for the disk
+    void close(); // writes what is queued, flushes and stops the thread
+
+    // Valid after close(), includes the resumed records
+    const std::map<SummaryKey, InstanceSummary>& summaries() const { return summaries_; }
+
+    static const char* header();
+
+private:
+    void writer_loop();
+    void write_record(const RunRecord& record);
+
+    std::ofstream file_;
+    bool open_;
+    std::map<std::pair<SummaryKey, int>, RunRecord> previous_;
+    std::map<SummaryKey, InstanceSummary> summaries_; // only touched by the writer thread until close()
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector<RunRecord> queue_;
+    bool closing_;
+    std::thread thread_;
+};
+
+#endif // RESULTS_H
@@ -0,0 +1,85 @@
+#include "schedule.h"
+#include <cmath>
+#include <algorithm>
+
+const char* cooling_kind_name(CoolingKind kind) {
+    switch (kind) {
+        case COOL_EXPONENTIAL: return "exponential";
+        case COOL_LUNDY_MEES: return "lundy_mees";
+        case COOL_ADAPTIVE: return "adaptive";
+        default: return "unknown";
+    }
+}
+
+CoolingSchedule::CoolingSchedule()
+    : kind(COOL_EXPONENTIAL), steps_per_temperature(0), lundy_beta(0.0), temperature_steps(1000),
+      target_decay(0.95), adapt_gain(2.0), min_factor(0.5), max_factor(0.99),
+      initial_samples(0), initial_acceptance(0.8), final_acceptance(0.01),
+      reheat_window(0), reheat_fraction(0.5), max_reheats(0),
+      initial_T(0.0), beta(0.0), target(0.0), reheats(0),
+      cooling_rate_(1.0), window_steps_(0), window_uphill_(0), window_uphill_accepted_(0) {}
+
+void CoolingSchedule::start(double T, double cooling_rate, double temp_threshold) {
+    initial_T = T;
+    cooling_rate_ = cooling_rate;
+    beta = lundy_beta;
+    if (beta <= 0.0) { // (1 / T_k) grows by beta per cooling, so K coolings go from T to temp_threshold
+        double final_T = std::max(temp_threshold, 1e-12);
+        beta = T > final_T ? (T - final_T) / (std::max(1L, temperature_steps) * T * final_T) : 1.0 / final_T;
+    }
+    target = initial_acceptance;
+    reheats = 0;
+    window_steps_ = 0;
+    window_uphill_ = 0;
+    window_uphill_accepted_ = 0;
+}
+
+double CoolingSchedule::update(double T, bool accepted, double delta) {
+    if (steps_per_temperature == 0 && kind != COOL_ADAPTIVE) {
+        if (!accepted || delta < 0) return T; //only cool if we accepted a worse solution
+        return kind == COOL_LUNDY_MEES ? T / (1.0 + beta * T) : T * cooling_rate_;
+    }
+
+    window_steps_++;
+    if (delta > 0) { // valid uphill proposal, the ones the temperature decides on
+        window_uphill_++;
+        if (accepted) window_uphill_accepted_++;
+    }
+    if (window_steps_ < (steps_per_temperature > 0 ? steps_per_temperature : DEFAULT_WINDOW)) return T;
+
+    double next = T;
+    switch (kind) {
+        case COOL_EXPONENTIAL:
+            next = T * cooling_rate_;
+            break;
+        case COOL_LUNDY_MEES:
+            next = T / (1.0 + beta * T);
+            break;
+        case COOL_ADAPTIVE: {
+            // too many uphill moves accepted -> cool faster, too few -> slower, never heats
+            double factor = max_factor;
+            if (window_uphill_ > 0) {
+                double observed = (double) window_uphill_accepted_ / window_uphill_;
+                factor = std::min(max_factor, std::max(min_factor, std::exp(adapt_gain * (target - observed))));
+            }
+            next = T * factor;
+            target *= target_decay;
+            break;
+        }
+        default:
+            break;
+    }
+    window_steps_ = 0;
+    window_uphill_ = 0;
+    window_uphill_accepted_ = 0;
+    return next;
+}
+
+double CoolingSchedule::reheat() {
+    reheats++;
+    target = initial_acceptance;
+    window_steps_ = 0;
+    window_uphill_ = 0;
+    window_uphill_accepted_ = 0;
+    return initial_T * reheat_fraction;
+}
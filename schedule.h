@@ -0,0 +1,64 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+//Tipos de enfriamiento
+enum CoolingKind {
+    COOL_EXPONENTIAL, // T *= cooling_rate (the original)
+    COOL_LUNDY_MEES,  // T = T / (1 + beta * T), slow at low temperatures
+    COOL_ADAPTIVE,    // factor from the uphill acceptance of the last window against a decaying target
+    NUM_COOLING_KINDS
+};
+
+const char* cooling_kind_name(CoolingKind kind);
+
+//Esquema de enfriamiento de BasicSimulatedAnnealing, se elige por corrida (campo schedule del
+// annealer). Los parametros son publicos, start() deja el estado listo al inicio de cada run.
+// Por defecto es el enfriamiento original: T *= cooling_rate tras cada movimiento cuesta arriba
+// aceptado, con el T y temp_threshold dados al annealer y sin recalentar.
+//
+// Con initial_samples > 0 el annealer estima T y temp_threshold antes del run a partir de la media
+// de los deltas cuesta arriba de movimientos de muestra: T0 = -media / ln(initial_acceptance) y
+// el umbral igual con final_acceptance, asi las temperaturas tienen la escala de los costos.
+// El recalentamiento sube T a reheat_fraction del T inicial y vuelve Current_sol a Best_sol, cuando
+// pasan reheat_window iteraciones sin mejorar Best_sol o T llega al umbral, hasta max_reheats veces
+class CoolingSchedule {
+public:
+    static const long DEFAULT_WINDOW = 100; // adaptive window when steps_per_temperature is 0
+
+    CoolingKind kind;
+    long steps_per_temperature; // 0 = cool after each accepted uphill move, else every that many steps
+    double lundy_beta;          // 0 = the beta that goes from T to temp_threshold in temperature_steps
+    long temperature_steps;
+    double target_decay;        // adaptive: the target acceptance is multiplied by this every window
+    double adapt_gain;          // adaptive: factor = exp(gain * (target - observed acceptance))
+    double min_factor;          // adaptive: the factor is kept in [min_factor, max_factor], below 1
+    double max_factor;
+    int initial_samples;        // 0 = no estimate, T and temp_threshold as given
+    double initial_acceptance;  // also the first target of the adaptive schedule
+    double final_acceptance;
+    long reheat_window;         // 0 = reheat only when T reaches temp_threshold
+    double reheat_fraction;
+    int max_reheats;            // 0 = no reheating
+
+    //Estado del run
+    double initial_T;
+    double beta;       // lundy_beta or the derived one
+    double target;     // current target acceptance of the adaptive schedule
+    int reheats;
+
+    CoolingSchedule();
+
+    void start(double T, double cooling_rate, double temp_threshold);
+    // Temperature after a step: accepted is true if the step applied a move, delta its cost change
+    double update(double T, bool accepted, double delta);
+    bool can_reheat() const { return reheats < max_reheats; }
+    double reheat(); // counts the reheat and returns the new temperature
+
+private:
+    double cooling_rate_;
+    long window_steps_;
+    long window_uphill_;
+    long window_uphill_accepted_;
+};
+
+#endif // SCHEDULE_H
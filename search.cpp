@@ -0,0 +1,336 @@
+#include "search.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+const uint8_t CLOSED = 0x80;
+const uint8_t NO_PARENT = 0x0F;
+const uint32_t NONE = 0xFFFFFFFFu;
+const float SQRT2 = 1.41421356f;
+
+// Mismo orden de direcciones que el DFS original
+const int DIR_X[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+const int DIR_Y[8] = {-1, 0, 1, 0, -1, 1, 1, -1};
+
+int direction_index(int dx, int dy) {
+    static const int table[3][3] = { // [dy + 1][dx + 1]
+        {7, 0, 4},
+        {3, -1, 1},
+        {6, 2, 5}
+    };
+    return table[dy + 1][dx + 1];
+}
+
+// Estado de una busqueda sobre el grid con borde, CORRIDOR agrega las celdas fuera del corredor
+// de ctx a los obstaculos (sin costo para las busquedas sin corredor)
+template <bool CORRIDOR>
+struct Search {
+    const OccupancyGrid& grid;
+    SearchContext& ctx;
+    int stride;
+    int directions; // 8, or 4 for the first (cardinal) directions only
+    uint32_t goal;
+    int goal_x;
+    int goal_y;
+
+    Search(const OccupancyGrid& grid, SearchContext& ctx, std::pair<int, int> end, int directions)
+        : grid(grid), ctx(ctx), stride(grid.stride()), directions(directions),
+          goal(grid.index(end.first, end.second)), goal_x(end.first), goal_y(end.second) {}
+
+    int offset(int d) const { return DIR_Y[d] * stride + DIR_X[d]; }
+    bool blocked(uint32_t cell) const {
+        return grid.blocked_at(cell) || (CORRIDOR && !ctx.in_corridor(cell));
+    }
+    bool touched(uint32_t cell) const { return ctx.stamp[cell] == ctx.generation; }
+    bool closed(uint32_t cell) const { return touched(cell) && (ctx.parent_dir[cell] & CLOSED); }
+
+    // Heuristica octile, admisible y consistente para costos 1 y sqrt(2), Manhattan con 4 direcciones
+    float heuristic(uint32_t cell) const {
+        int dx = std::abs((int)(cell % stride) - 1 - goal_x);
+        int dy = std::abs((int)(cell / stride) - 1 - goal_y);
+        if (directions == 4) return (float)(dx + dy);
+        int lo = std::min(dx, dy);
+        int hi = std::max(dx, dy);
+        return (hi - lo) + SQRT2 * lo;
+    }
+
+    void touch(uint32_t cell, float g, int dir) {
+        ctx.stamp[cell] = ctx.generation;
+        ctx.g[cell] = g;
+        ctx.parent_dir[cell] = (uint8_t) dir;
+    }
+
+    void push(uint32_t cell, float g) {
+        SearchContext::OpenEntry entry = {g + heuristic(cell), g, cell};
+        ctx.open.push_back(entry);
+        std::push_heap(ctx.open.begin(), ctx.open.end(), worse);
+    }
+
+    static bool worse(const SearchContext::OpenEntry& a, const SearchContext::OpenEntry& b) {
+        return a.f > b.f || (a.f == b.f && a.g < b.g); // ties go to the deeper node
+    }
+
+    // Actualiza una celda alcanzada desde un nodo expandido con costo g
+    void relax(uint32_t cell, float g, int dir) {
+        if (!touched(cell)) {
+            touch(cell, g, dir);
+            push(cell, g);
+        } else if (!(ctx.parent_dir[cell] & CLOSED) && g < ctx.g[cell]) {
+            touch(cell, g, dir);
+            push(cell, g);
+        }
+    }
+
+    bool astar(uint32_t start);
+    bool jps(uint32_t start);
+    bool dfs(uint32_t start);
+    uint32_t jump(uint32_t cell, int dx, int dy, int& steps) const;
+    bool has_forced(uint32_t cell, int dx, int dy) const;
+    void reconstruct(uint32_t start, std::vector<std::pair<int, int>>& path) const;
+};
+
+template <bool CORRIDOR>
+bool Search<CORRIDOR>::astar(uint32_t start) {
+    touch(start, 0.0f, NO_PARENT);
+    push(start, 0.0f);
+
+    while (!ctx.open.empty()) {
+        std::pop_heap(ctx.open.begin(), ctx.open.end(), worse);
+        SearchContext::OpenEntry current = ctx.open.back();
+        ctx.open.pop_back();
+
+        uint32_t cell = current.cell;
+        if ((ctx.parent_dir[cell] & CLOSED) || current.g > ctx.g[cell]) continue; // stale entry
+        ctx.parent_dir[cell] |= CLOSED;
+        if (cell == goal) return true;
+
+        for (int d = 0; d < directions; ++d) {
+            uint32_t next = cell + offset(d);
+            if (blocked(next)) continue;
+            relax(next, current.g + (d < 4 ? 1.0f : SQRT2), d);
+        }
+    }
+    return false;
+}
+
+// Vecinos forzados (Harabor y Grastien 2011, con diagonales que pasan por esquinas)
+template <bool CORRIDOR>
+bool Search<CORRIDOR>::has_forced(uint32_t cell, int dx, int dy) const {
+    if (dx != 0 && dy != 0) {
+        return (blocked(cell - dx) && !blocked(cell - dx + dy * stride)) ||
+               (blocked(cell - dy * stride) && !blocked(cell + dx - dy * stride));
+    }
+    if (dx != 0) {
+        return (blocked(cell + stride) && !blocked(cell + dx + stride)) ||
+               (blocked(cell - stride) && !blocked(cell + dx - stride));
+    }
+    return (blocked(cell + 1) && !blocked(cell + 1 + dy * stride)) ||
+           (blocked(cell - 1) && !blocked(cell - 1 + dy * stride));
+}
+
+// Avanza en la direccion (dx, dy) hasta un punto de salto, el objetivo, o un obstaculo (NONE)
+template <bool CORRIDOR>
+uint32_t Search<CORRIDOR>::jump(uint32_t cell, int dx, int dy, int& steps) const {
+    int step = dy * stride + dx;
+    for (;;) {
+        cell += step;
+        steps++;
+        if (blocked(cell)) return NONE;
+        if (cell == goal || has_forced(cell, dx, dy)) return cell;
+        if (dx != 0 && dy != 0) {
+            int straight_steps = 0;
+            if (jump(cell, dx, 0, straight_steps) != NONE) return cell;
+            straight_steps = 0;
+            if (jump(cell, 0, dy, straight_steps) != NONE) return cell;
+        }
+    }
+}
+
+template <bool CORRIDOR>
+bool Search<CORRIDOR>::jps(uint32_t start) {
+    touch(start, 0.0f, NO_PARENT);
+    push(start, 0.0f);
+
+    while (!ctx.open.empty()) {
+        std::pop_heap(ctx.open.begin(), ctx.open.end(), worse);
+        SearchContext::OpenEntry current = ctx.open.back();
+        ctx.open.pop_back();
+
+        uint32_t cell = current.cell;
+        if ((ctx.parent_dir[cell] & CLOSED) || current.g > ctx.g[cell]) continue;
+        ctx.parent_dir[cell] |= CLOSED;
+        if (cell == goal) return true;
+
+        // Pruned directions from the direction we arrived with
+        int dirs[8];
+        int count = 0;
+        int from = ctx.parent_dir[cell] & 0x0F;
+        if (from == NO_PARENT) {
+            for (int d = 0; d < 8; ++d) dirs[count++] = d;
+        } else {
+            int dx = DIR_X[from];
+            int dy = DIR_Y[from];
+            if (dx != 0 && dy != 0) {
+                dirs[count++] = direction_index(dx, 0);
+                dirs[count++] = direction_index(0, dy);
+                dirs[count++] = from;
+                if (blocked(cell - dx)) dirs[count++] = direction_index(-dx, dy);
+                if (blocked(cell - dy * stride)) dirs[count++] = direction_index(dx, -dy);
+            } else if (dx != 0) {
+                dirs[count++] = from;
+                if (blocked(cell + stride)) dirs[count++] = direction_index(dx, 1);
+                if (blocked(cell - stride)) dirs[count++] = direction_index(dx, -1);
+            } else {
+                dirs[count++] = from;
+                if (blocked(cell + 1)) dirs[count++] = direction_index(1, dy);
+                if (blocked(cell - 1)) dirs[count++] = direction_index(-1, dy);
+            }
+        }
+
+        for (int k = 0; k < count; ++k) {
+            int d = dirs[k];
+            int steps = 0;
+            uint32_t next = jump(cell, DIR_X[d], DIR_Y[d], steps);
+            if (next == NONE) continue;
+            relax(next, current.g + steps * (d < 4 ? 1.0f : SQRT2), d);
+        }
+    }
+    return false;
+}
+
+// DFS original: se marca al apilar, vecinos en el orden de DIR_X/DIR_Y
+template <bool CORRIDOR>
+bool Search<CORRIDOR>::dfs(uint32_t start) {
+    touch(start, 0.0f, NO_PARENT | CLOSED);
+    ctx.stack.push_back(start);
+
+    while (!ctx.stack.empty()) {
+        uint32_t cell = ctx.stack.back();
+        ctx.stack.pop_back();
+        if (cell == goal) return true;
+
+        for (int d = 0; d < directions; ++d) {
+            uint32_t next = cell + offset(d);
+            if (!blocked(next) && !touched(next)) {
+                touch(next, ctx.g[cell] + (d < 4 ? 1.0f : SQRT2), d | CLOSED); // g along the DFS tree
+                ctx.stack.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+// Reconstruccion desde el objetivo: se retrocede en la direccion del padre celda por celda
+// hasta la celda cerrada con el g esperado, en JPS el padre puede estar a varias celdas y en el
+// camino puede haber otras celdas cerradas. Si se llega a un obstaculo se usa la ultima cerrada
+template <bool CORRIDOR>
+void Search<CORRIDOR>::reconstruct(uint32_t start, std::vector<std::pair<int, int>>& path) const {
+    uint32_t cell = goal;
+    size_t limit = grid.padded_cells();
+    while (cell != start && path.size() < limit) {
+        int d = ctx.parent_dir[cell] & 0x0F;
+        int back = -offset(d);
+        float unit = d < 4 ? 1.0f : SQRT2;
+        float g = ctx.g[cell];
+        float tolerance = 1e-4f + 1e-5f * g;
+        int k = 0;
+        for (;;) {
+            path.push_back({(int)(cell % stride) - 1, (int)(cell / stride) - 1});
+            cell += back;
+            k++;
+            if (closed(cell) && (std::fabs(ctx.g[cell] - (g - k * unit)) <= tolerance || blocked(cell + back))) {
+                break;
+            }
+        }
+    }
+    path.push_back({(int)(start % stride) - 1, (int)(start / stride) - 1});
+    std::reverse(path.begin(), path.end());
+}
+
+// Metodo elegido sobre una busqueda ya preparada, el camino queda en path si se encuentra
+template <class S>
+bool run_search(S& search, const OccupancyGrid& grid, uint32_t start_cell, SeedMethod method,
+                SearchContext& context, std::vector<std::pair<int, int>>& path) {
+    bool found;
+    if (method == SEED_DFS) {
+        found = search.dfs(start_cell);
+    } else if (method == SEED_JPS && search.directions == 8) { // the pruning rules are for 8 directions
+        found = search.jps(start_cell);
+        if (!found) { // pruning missed a path, plain A* is complete
+            context.prepare(grid.padded_cells());
+            found = search.astar(start_cell);
+        }
+    } else {
+        found = search.astar(start_cell);
+    }
+
+    if (found) {
+        search.reconstruct(start_cell, path);
+    }
+    return found;
+}
+
+} // namespace
+
+SearchContext::SearchContext() : generation(0), corridor_generation(0), corridor_active(false) {}
+
+void SearchContext::prepare(size_t padded_cells) {
+    if (stamp.size() < padded_cells) {
+        stamp.assign(padded_cells, 0);
+        g.resize(padded_cells);
+        parent_dir.resize(padded_cells);
+        generation = 0;
+    }
+    generation++;
+    if (generation == 0) { // wrapped around, old stamps could look current
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+    open.clear();
+    stack.clear();
+}
+
+void SearchContext::begin_corridor(size_t padded_cells) {
+    if (corridor.size() < padded_cells) {
+        corridor.assign(padded_cells, 0);
+        corridor_generation = 0;
+    }
+    corridor_generation++;
+    if (corridor_generation == 0) {
+        std::fill(corridor.begin(), corridor.end(), 0);
+        corridor_generation = 1;
+    }
+    corridor_active = true;
+}
+
+size_t SearchContext::memory_bytes() const {
+    return stamp.capacity() * sizeof(uint32_t) + g.capacity() * sizeof(float) +
+           parent_dir.capacity() + open.capacity() * sizeof(OpenEntry) +
+           stack.capacity() * sizeof(uint32_t) + corridor.capacity() * sizeof(uint32_t);
+}
+
+bool find_path(const OccupancyGrid& grid, std::pair<int, int> start, std::pair<int, int> end,
+               SeedMethod method, SearchContext& context, std::vector<std::pair<int, int>>& path,
+               int connectivity) {
+    path.clear();
+    if (!grid.in_bounds(start.first, start.second) || !grid.in_bounds(end.first, end.second) ||
+        grid.blocked(start.first, start.second) || grid.blocked(end.first, end.second)) {
+        return false;
+    }
+    if (context.corridor_active && (!context.in_corridor(grid.index(start.first, start.second)) ||
+                                    !context.in_corridor(grid.index(end.first, end.second)))) {
+        return false;
+    }
+
+    context.prepare(grid.padded_cells());
+    uint32_t start_cell = grid.index(start.first, start.second);
+    int directions = connectivity == 4 ? 4 : 8;
+    if (context.corridor_active) {
+        Search<true> search(grid, context, end, directions);
+        return run_search(search, grid, start_cell, method, context, path);
+    }
+    Search<false> search(grid, context, end, directions);
+    return run_search(search, grid, start_cell, method, context, path);
+}
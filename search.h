@@ -0,0 +1,60 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "grid.h"
+
+//Metodo para el camino inicial
+enum SeedMethod {
+    SEED_ASTAR, // A* with the octile heuristic, near-optimal seed
+    SEED_JPS,   // jump point search, same paths as A* with far fewer expanded cells on open maps
+    SEED_DFS    // the original depth-first search, long winding seeds
+};
+
+//Memoria de trabajo de las busquedas, se reutiliza entre llamadas.
+// Cada celda guarda la generacion en que fue tocada (asi no hay que limpiar los arreglos
+// entre busquedas), su costo g y un byte con la direccion desde su padre y si esta cerrada
+class SearchContext {
+public:
+    SearchContext();
+
+    void prepare(size_t padded_cells); // grows the arrays and starts a new generation
+    size_t memory_bytes() const;
+
+    // Optional corridor: while active, find_path treats every cell outside it as an obstacle.
+    // Marking uses its own generation, so starting a new corridor costs nothing per cell
+    void begin_corridor(size_t padded_cells);
+    void add_to_corridor(size_t cell) { corridor[cell] = corridor_generation; }
+    bool in_corridor(size_t cell) const { return corridor[cell] == corridor_generation; }
+    void end_corridor() { corridor_active = false; }
+
+    struct OpenEntry {
+        float f;
+        float g;
+        uint32_t cell;
+    };
+
+    std::vector<uint32_t> stamp;
+    std::vector<float> g;
+    std::vector<uint8_t> parent_dir; // bits 0-3: direction index from the parent, bit 7: closed
+    std::vector<OpenEntry> open;     // binary heap
+    std::vector<uint32_t> stack;     // DFS
+    uint32_t generation;
+    std::vector<uint32_t> corridor;  // corridor_generation for the cells inside
+    uint32_t corridor_generation;
+    bool corridor_active;
+};
+
+//Busca un camino 8-conexo de start a end con el metodo dado, el camino queda en path
+// como una secuencia de celdas vecinas. Retorna false (y path vacio) si no existe.
+// JPS vuelve a A* si no encuentra camino. Con connectivity = 4 el camino solo usa pasos
+// cardinales (JPS se reemplaza por A*). Con un corredor activo en context el camino queda dentro
+// de el, inicio y final tienen que estar en el corredor
+bool find_path(const OccupancyGrid& grid, std::pair<int, int> start, std::pair<int, int> end,
+               SeedMethod method, SearchContext& context, std::vector<std::pair<int, int>>& path,
+               int connectivity = 8);
+
+#endif // SEARCH_H
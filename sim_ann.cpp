@@ -2,275 +2,747 @@
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 
 //Constructor con los parametros basicos para SA
-SimulatedAnnealing::SimulatedAnnealing(double T, double cooling_rate, double temp_threshold, 
-                                       const GridInstance& grid_inst) {
+template <class Cost, class Connectivity>
+BasicSimulatedAnnealing<Cost, Connectivity>::BasicSimulatedAnnealing(double T, double cooling_rate, double temp_threshold, 
+                                                                 const GridInstance& grid_inst) {
+    init(T, cooling_rate, temp_threshold, grid_inst);
+    this->Current_sol = generate_initial_path();
+    this->Best_sol = this->Current_sol;
+}
+
+//Constructor con un camino inicial ya calculado (por ejemplo desde InstanceCache)
+template <class Cost, class Connectivity>
+BasicSimulatedAnnealing<Cost, Connectivity>::BasicSimulatedAnnealing(double T, double cooling_rate, double temp_threshold, 
+                                                                 const GridInstance& grid_inst,
+                                                                 const std::vector<std::pair<int, int>>& initial_path) {
+    init(T, cooling_rate, temp_threshold, grid_inst);
+    this->Current_sol = initial_path;
+    this->Best_sol = this->Current_sol;
+}
+
+//Valores por defecto comunes a ambos constructores
+template <class Cost, class Connectivity>
+void BasicSimulatedAnnealing<Cost, Connectivity>::init(double T, double cooling_rate, double temp_threshold, 
+                                                       const GridInstance& grid_inst) {
     this->T = T;
     this->cooling_rate = cooling_rate;
     this->temp_threshold = temp_threshold;
     this->grid_instance = grid_inst;
     this->random_seed = std::time(0);
-    this->Current_sol = generate_initial_path();
-    this->Best_sol = this->Current_sol;
+    this->last_move.type = MOVE_SHIFT;
+    this->last_move.index = -1;
+    this->current_cost = 0.0;
+    this->best_cost = 0.0;
+    this->iterations = 0;
+    this->batch_size = 1;
+    this->batch_selection = BATCH_METROPOLIS;
+    this->shortening_window = 8;
+    for (int t = 0; t < NUM_MOVE_TYPES; ++t) this->move_weights[t] = 0.0;
+    this->move_weights[MOVE_SHIFT] = 1.0; // only the original move by default
+    this->seed_method = SEED_ASTAR;
+    this->search_context = nullptr;
+    this->stop_reason = STOP_TEMPERATURE;
+    this->repair_radius = 4;
+    if (!this->grid_instance.masks.matches(this->grid_instance.grid)) { // InstanceCache builds them once
+        this->grid_instance.masks = NeighborMasks::build(this->grid_instance.grid);
+    }
+    this->cost_policy.prepare(this->grid_instance.grid);
     
-    std::srand(this->random_seed); //seed for randomness
+    this->rng.seed(this->random_seed); //seed for randomness, own engine per instance
 }
 
-void SimulatedAnnealing::set_random_seed(unsigned seed) {
+template <class Cost, class Connectivity>
+void BasicSimulatedAnnealing<Cost, Connectivity>::set_random_seed(unsigned seed) {
     this->random_seed = seed;
-    std::srand(seed);
+    this->rng.seed(seed);
 }
 
 //Funcion de evaluacion del costo de la solucion, 
-// en este caso la distancia euclidiana entre los puntos del camino
+// segun la politica Cost (la distancia euclidiana entre los puntos del camino en la original)
 // con penalizacion por obstaculos
-double SimulatedAnnealing::evaluate_cost(const std::vector<std::pair<int, int>>& path) {
-    double cost = 0.0;
-    
+template <class Cost, class Connectivity>
+double BasicSimulatedAnnealing<Cost, Connectivity>::evaluate_cost(const std::vector<std::pair<int, int>>& path) {
     if (!is_valid_path(path)) { //penalize invalid paths
         return std::numeric_limits<double>::max();
     }
-    
-    for (size_t i = 0; i < path.size() - 1; ++i) {
-        double dx = path[i+1].first - path[i].first;
-        double dy = path[i+1].second - path[i].second;
-        cost += std::sqrt(dx * dx + dy * dy);
+    return window_cost(path.data(), path.size());
+}
+
+//Costo de una secuencia de puntos: sus segmentos en orden y luego los giros de los puntos interiores
+template <class Cost, class Connectivity>
+double BasicSimulatedAnnealing<Cost, Connectivity>::window_cost(const std::pair<int, int>* points, size_t count) {
+    double cost = 0.0;
+    for (size_t i = 0; i + 1 < count; ++i) {
+        cost += cost_policy.segment(points[i], points[i+1]);
+    }
+    if (Cost::HAS_TURNS) {
+        for (size_t i = 1; i + 1 < count; ++i) {
+            cost += cost_policy.turn(points[i-1], points[i], points[i+1]);
+        }
     }
     return cost;
 }
 
-//Movimiento (generacion de vecino) aleatorio,
-// se elige un punto aleatorio del camino y se le aplica una perturbacion aleatoria
-// respetando las restricciones del grid y manteniendo la continuidad del camino
-std::vector<std::pair<int, int>> SimulatedAnnealing::generate_neighbor(const std::vector<std::pair<int, int>>& path) {
+//Distancia de Chebyshev, dos puntos del camino estan conectados si es <= 1
+template <class Cost, class Connectivity>
+int BasicSimulatedAnnealing<Cost, Connectivity>::chebyshev(const std::pair<int, int>& a, const std::pair<int, int>& b) {
+    return std::max(std::abs(a.first - b.first), std::abs(a.second - b.second));
+}
+
+//Costo de un segmento del camino, el largo euclidiano en la original
+template <class Cost, class Connectivity>
+double BasicSimulatedAnnealing<Cost, Connectivity>::segment_cost(const std::pair<int, int>& a, const std::pair<int, int>& b) {
+    return cost_policy.segment(a, b);
+}
+
+//Verifica solo la parte del camino que cambia y su conexion con el resto,
+// el resto del camino ya era valido antes del movimiento
+template <class Cost, class Connectivity>
+bool BasicSimulatedAnnealing<Cost, Connectivity>::is_valid_move(const std::vector<std::pair<int, int>>& path, const Move& move) {
+    if (move.index < 0) return true; // unchanged path
+
+    if (move.type != MOVE_SHIFT) { // new points (move_points) between index - 1 and end
+        const std::pair<int, int>* prev = &path[move.index - 1];
+        for (const auto& pos : move_points) {
+            if (!Connectivity::adjacent(*prev, pos) || !is_valid_position(pos)) return false;
+            prev = &pos;
+        }
+        return Connectivity::adjacent(*prev, path[move.end]);
+    }
+
+    const std::pair<int, int>& prev = path[move.index - 1];
+    const std::pair<int, int>& next = path[move.index + 1];
+
+    return Connectivity::adjacent(move.new_pos, prev) && Connectivity::adjacent(move.new_pos, next) &&
+           is_valid_position(move.new_pos);
+}
+
+//Diferencia de costo del movimiento, solo cambian los dos segmentos que tocan el punto movido,
+// o los segmentos entre index - 1 y end para los movimientos de acortamiento.
+// Si el costo tiene giros tambien cambian los de los puntos vecinos, se comparan las ventanas
+// del camino antes y despues desde dos puntos antes del cambio hasta uno despues
+template <class Cost, class Connectivity>
+double BasicSimulatedAnnealing<Cost, Connectivity>::evaluate_delta(const std::vector<std::pair<int, int>>& path, const Move& move) {
+    if (move.index < 0) return 0.0;
+
+    if (Cost::HAS_TURNS) {
+        int kept_before = move.index - 1;                                      // last unchanged point before
+        int kept_after = move.type == MOVE_SHIFT ? move.index + 1 : move.end;  // first unchanged point after
+        int lo = std::max(0, kept_before - 1);
+        int hi = std::min((int) path.size() - 1, kept_after + 1);
+        delta_window.assign(path.begin() + lo, path.begin() + kept_before + 1);
+        if (move.type == MOVE_SHIFT) {
+            delta_window.push_back(move.new_pos);
+        } else {
+            delta_window.insert(delta_window.end(), move_points.begin(), move_points.end());
+        }
+        delta_window.insert(delta_window.end(), path.begin() + kept_after, path.begin() + hi + 1);
+        return window_cost(delta_window.data(), delta_window.size()) - window_cost(&path[lo], hi - lo + 1);
+    }
+
+    if (move.type != MOVE_SHIFT) {
+        double removed = 0.0;
+        for (int k = move.index - 1; k < move.end; ++k) {
+            removed += segment_cost(path[k], path[k+1]);
+        }
+        double added = 0.0;
+        const std::pair<int, int>* prev = &path[move.index - 1];
+        for (const auto& pos : move_points) {
+            added += segment_cost(*prev, pos);
+            prev = &pos;
+        }
+        added += segment_cost(*prev, path[move.end]);
+        return added - removed;
+    }
+
+    const std::pair<int, int>& prev = path[move.index - 1];
+    const std::pair<int, int>& next = path[move.index + 1];
+    return (segment_cost(prev, move.new_pos) + segment_cost(move.new_pos, next))
+         - (segment_cost(prev, move.old_pos) + segment_cost(move.old_pos, next));
+}
+
+//Movimiento (generacion de vecino) aleatorio, copia el camino y le aplica propose_move,
+// se mantiene por compatibilidad, run() trabaja en el lugar sobre Current_sol
+template <class Cost, class Connectivity>
+std::vector<std::pair<int, int>> BasicSimulatedAnnealing<Cost, Connectivity>::generate_neighbor(const std::vector<std::pair<int, int>>& path) {
     std::vector<std::pair<int, int>> neighbor = path;
+    last_move = propose_move(path);
+    if (last_move.index >= 0) {
+        neighbor[last_move.index] = last_move.new_pos;
+    }
+    return neighbor;
+}
+
+//Propuesta de movimiento sin copiar el camino,
+// se elige un punto aleatorio del camino y uno de sus vecinos libres que mantiene la
+// continuidad con prev y next (mascara del grid y tabla de adyacencia), sin reintentos.
+// Si el punto no tiene movimiento se retorna index = -1 (movimiento nulo, como antes)
+template <class Cost, class Connectivity>
+Move BasicSimulatedAnnealing<Cost, Connectivity>::propose_move(const std::vector<std::pair<int, int>>& path) {
+    Move move;
+    move.type = MOVE_SHIFT;
+    move.index = -1;
     
-    if (path.size() <= 2) return neighbor; // Can't modify start/end only paths
+    if (path.size() <= 2) return move; // Can't modify start/end only paths
     
-        int i = rand() % (path.size() - 2) + 1; // start and end static
-        
-        std::pair<int, int> prev = path[i-1];
-        std::pair<int, int> next = path[i+1];
-        
-        for (int attempts = 0; attempts < 20; ++attempts) {
-            int dx = (rand() % 3) - 1; // -1, 0, 1
-            int dy = (rand() % 3) - 1;
-            
-            std::pair<int, int> new_pos = {path[i].first + dx, path[i].second + dy};
-            bool valid_connection = false;
-            
-            int dist_to_prev = std::max(std::abs(new_pos.first - prev.first), 
-                                      std::abs(new_pos.second - prev.second));
-            int dist_to_next = std::max(std::abs(new_pos.first - next.first), 
-                                      std::abs(new_pos.second - next.second));
-            
-            valid_connection = (dist_to_prev <= 1 && dist_to_next <= 1);
-            if (is_valid_position(new_pos) && valid_connection) {
-                neighbor[i] = new_pos;
+    int i = rng() % (path.size() - 2) + 1; // start and end static
+    
+    const std::pair<int, int>& pos = path[i];
+    const std::pair<int, int>& prev = path[i-1];
+    const std::pair<int, int>& next = path[i+1];
+    uint8_t legal = grid_instance.masks.free_mask(grid_instance.grid.index(pos.first, pos.second)) &
+                    Connectivity::move_mask(prev.first - pos.first, prev.second - pos.second,
+                                            next.first - pos.first, next.second - pos.second);
+    if (legal == 0) {
+        telemetry.count(TM_NULL_MOVES);
+        return move;
+    }
+    
+    int d = NeighborMasks::nth_direction(legal, rng() % NeighborMasks::count(legal));
+    move.index = i;
+    move.old_pos = pos;
+    move.new_pos = {pos.first + NEIGHBOR_OFFSETS[d][0], pos.second + NEIGHBOR_OFFSETS[d][1]};
+    return move;
+}
+
+//Movimientos que acortan Current_sol, el camino nuevo entre index - 1 y end queda en move_points.
+// Si no hay un movimiento posible en el punto elegido se retorna index = -1
+template <class Cost, class Connectivity>
+Move BasicSimulatedAnnealing<Cost, Connectivity>::propose_shortening(MoveType type) {
+    Move move;
+    move.type = type;
+    move.index = -1;
+    move_points.clear();
+
+    const std::vector<std::pair<int, int>>& path = Current_sol;
+    if (path.size() <= 2) return move;
+
+    if (type == MOVE_REMOVE_POINT) { // drop i if i-1 and i+1 are already connected
+        int i = rng() % (path.size() - 2) + 1;
+        if (Connectivity::adjacent(path[i-1], path[i+1])) {
+            move.index = i;
+            move.end = i + 1;
+        }
+        return move;
+    }
+
+    int i = rng() % (path.size() - 2); // first kept point, i + 2 <= last point
+    int last = std::min((int) path.size() - 1, i + shortening_window);
+    if (last < i + 2) return move; // window under 2, no j >= i + 2 to cut to
+
+    if (type == MOVE_SPLICE_LOOP) { // farthest j in the window adjacent to i, cut i+1..j-1
+        for (int j = last; j >= i + 2; --j) {
+            if (Connectivity::adjacent(path[i], path[j])) {
+                move.index = i + 1;
+                move.end = j;
                 break;
             }
         }
-    return neighbor;
+        return move;
+    }
+
+    // MOVE_SHORTCUT, straight run from i to j with the connectivity of the path
+    int j = i + 2 + rng() % (last - i - 1);
+    int dx = path[j].first - path[i].first;
+    int dy = path[j].second - path[i].second;
+    int steps = Connectivity::line_steps(dx, dy);
+    for (int k = 1; k < steps; ++k) {
+        std::pair<int, int> pos = Connectivity::line_point(path[i], dx, dy, steps, k);
+        if (!is_valid_position(pos)) { // run blocked by an obstacle
+            move_points.clear();
+            return move;
+        }
+        move_points.push_back(pos);
+    }
+    move.index = i + 1;
+    move.end = j;
+    return move;
 }
 
-//Ver si la posicion esta dentro del grid y no chocando con un obstaculo
-// Retorna true si es una posicion valida, false si es un obstaculo o fuera
-bool SimulatedAnnealing::is_valid_position(const std::pair<int, int>& pos) {
-    int x = pos.first;
-    int y = pos.second;
-    
-    if (x < 0 || x >= grid_instance.cols || y < 0 || y >= grid_instance.rows) {
-        return false;
+//Aplica el movimiento en el lugar, los de acortamiento nunca agregan puntos
+// asi que no hay reserva de memoria, los puntos quitados se guardan para revert_move
+template <class Cost, class Connectivity>
+void BasicSimulatedAnnealing<Cost, Connectivity>::apply_move(const Move& move) {
+    if (move.index < 0) return;
+
+    if (move.type == MOVE_SHIFT) {
+        Current_sol[move.index] = move.new_pos;
+        return;
     }
-    
-    return grid_instance.grid[y][x] != 1; // 1 = obstacle
+    removed_points.assign(Current_sol.begin() + move.index, Current_sol.begin() + move.end);
+    std::copy(move_points.begin(), move_points.end(), Current_sol.begin() + move.index);
+    Current_sol.erase(Current_sol.begin() + move.index + move_points.size(), Current_sol.begin() + move.end);
+}
+
+template <class Cost, class Connectivity>
+void BasicSimulatedAnnealing<Cost, Connectivity>::revert_move(const Move& move) {
+    if (move.index < 0) return;
+
+    if (move.type == MOVE_SHIFT) {
+        Current_sol[move.index] = move.old_pos;
+        return;
+    }
+    Current_sol.erase(Current_sol.begin() + move.index, Current_sol.begin() + move.index + move_points.size());
+    Current_sol.insert(Current_sol.begin() + move.index, removed_points.begin(), removed_points.end());
+}
+
+//Elige el tipo de movimiento segun move_weights, si solo el movimiento
+// original tiene peso no se usa un numero aleatorio (misma secuencia que antes)
+template <class Cost, class Connectivity>
+MoveType BasicSimulatedAnnealing<Cost, Connectivity>::choose_move_type() {
+    double total = 0.0;
+    for (int t = 0; t < NUM_MOVE_TYPES; ++t) total += move_weights[t];
+    if (total <= move_weights[MOVE_SHIFT]) return MOVE_SHIFT;
+
+    double u = (double) rng() / rng.max() * total;
+    int type = MOVE_SHIFT;
+    for (int t = 0; t < NUM_MOVE_TYPES; ++t) {
+        if (move_weights[t] <= 0.0) continue;
+        type = t;
+        if (u < move_weights[t]) break;
+        u -= move_weights[t];
+    }
+    return (MoveType) type;
+}
+
+//Ver si la posicion esta dentro del grid y no chocando con un obstaculo
+// Retorna true si es una posicion valida, false si es un obstaculo o fuera.
+// La posicion debe estar a lo mas a una celda del grid, el borde del OccupancyGrid es obstaculo
+template <class Cost, class Connectivity>
+bool BasicSimulatedAnnealing<Cost, Connectivity>::is_valid_position(const std::pair<int, int>& pos) {
+    return !grid_instance.grid.blocked(pos.first, pos.second);
 }
 
 //Verifica si el camino es valido, curva suave, todos los puntos conectados
-// y que el camino comienza en el punto de inicio y termina en el punto final
-bool SimulatedAnnealing::is_valid_path(const std::vector<std::pair<int, int>>& path) {
+// y que el camino comienza en el punto de inicio y termina en el punto final.
+// Se revisa la conexion antes que la posicion, asi cada punto queda a una celda de uno valido
+template <class Cost, class Connectivity>
+bool BasicSimulatedAnnealing<Cost, Connectivity>::is_valid_path(const std::vector<std::pair<int, int>>& path) {
     if (path.empty()) return false;
     
-    for (const auto& pos : path) {
-        if (!is_valid_position(pos)) {
-            return false;
-        }
-    }
-    for (size_t i = 0; i < path.size() - 1; ++i) {
-        int dx = std::abs(path[i+1].first - path[i].first);
-        int dy = std::abs(path[i+1].second - path[i].second);
-        if (dx > 1 || dy > 1) {
-            return false;
-        }
-    }
     if (path.front().first != grid_instance.start.first || 
         path.front().second != grid_instance.start.second ||
         path.back().first != grid_instance.end.first || 
         path.back().second != grid_instance.end.second) {
         return false;
     }
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (i > 0 && !Connectivity::adjacent(path[i], path[i-1])) {
+            return false;
+        }
+        if (!is_valid_position(path[i])) {
+            return false;
+        }
+    }
     return true;
 }
 
-//Solucion inicial generada con DFS, si no se encuentra un camino valido,
-// se intenta con BFS, y si no se encuentra, se crea un camino directo
-std::vector<std::pair<int, int>> SimulatedAnnealing::generate_initial_path() {
+//Solucion inicial con seed_method (A* por defecto, search.cpp), la memoria de trabajo
+// es search_context o, si no hay, una por hilo que se reutiliza entre llamadas
+template <class Cost, class Connectivity>
+std::vector<std::pair<int, int>> BasicSimulatedAnnealing<Cost, Connectivity>::generate_initial_path() {
+    static thread_local SearchContext thread_context;
+    PhaseTimer timer(telemetry, PHASE_SEED);
     std::vector<std::pair<int, int>> path;
     
-    std::vector<std::vector<bool>> visited(grid_instance.rows, std::vector<bool>(grid_instance.cols, false));
-    std::vector<std::vector<std::pair<int, int>>> parent(grid_instance.rows, 
-                                                       std::vector<std::pair<int, int>>(grid_instance.cols, 
-                                                                                     {-1, -1}));
-    std::vector<std::pair<int, int>> stack;
-    
-    stack.push_back(grid_instance.start);
-    visited[grid_instance.start.second][grid_instance.start.first] = true;
-    
-    bool found = false;
+    find_path(grid_instance.grid, grid_instance.start, grid_instance.end, seed_method,
+              search_context ? *search_context : thread_context, path, Connectivity::DEGREE);
     
-    std::vector<std::pair<int, int>> moves = {// cardinal and intercardinal 
-        {0, -1}, {1, 0}, {0, 1}, {-1, 0}, {1, -1}, {1, 1}, {-1, 1}, {-1, -1}
-    };
+    std::cout << "Initial sol with " << path.size() << " points\n";
+    return path;
+}
+
+//Costos iniciales antes de iterar, si el camino actual no es valido se vuelve a generar
+template <class Cost, class Connectivity>
+void BasicSimulatedAnnealing<Cost, Connectivity>::prepare_run(bool print_progress) {
+    current_cost = evaluate_cost(Current_sol);
+    best_cost = evaluate_cost(Best_sol);
+    iterations = 0;
     
-    while (!stack.empty() && !found) {
-        std::pair<int, int> current = stack.back();
-        stack.pop_back();
-        
-        if (current.first == grid_instance.end.first && current.second == grid_instance.end.second) {
-            found = true;
-            break;
+    if (!is_valid_path(Current_sol)) {
+        if (print_progress) {
+            std::cout << "Initial sol not valid\n";
         }
-        for (const auto& move : moves) {
-            int nx = current.first + move.first;
-            int ny = current.second + move.second;
-            std::pair<int, int> next_pos = {nx, ny};
-            
-            if (is_valid_position(next_pos) && !visited[ny][nx]) {
-                visited[ny][nx] = true;
-                parent[ny][nx] = current;
-                stack.push_back(next_pos);
-            }
+        Current_sol = generate_initial_path();
+        Best_sol = Current_sol;
+        current_cost = evaluate_cost(Current_sol);
+        best_cost = current_cost;
+    }
+}
+
+//Media del aumento de costo de los movimientos validos cuesta arriba entre samples propuestas
+// desde Current_sol, sin aplicarlas. Es la escala de los deltas para estimar T y temp_threshold
+template <class Cost, class Connectivity>
+double BasicSimulatedAnnealing<Cost, Connectivity>::sample_uphill_delta(int samples) {
+    double sum = 0.0;
+    long uphill = 0;
+    for (int s = 0; s < samples; ++s) {
+        MoveType type = choose_move_type();
+        Move move = type == MOVE_SHIFT ? propose_move(Current_sol) : propose_shortening(type);
+        if (move.index < 0 || (type != MOVE_SHIFT && !is_valid_move(Current_sol, move))) continue;
+        double delta = evaluate_delta(Current_sol, move);
+        if (delta > 0) {
+            sum += delta;
+            uphill++;
         }
     }
+    return uphill > 0 ? sum / uphill : 0.0;
+}
+
+template <class Cost, class Connectivity>
+void BasicSimulatedAnnealing<Cost, Connectivity>::reheat() {
+    T = schedule.reheat();
+    Current_sol = Best_sol;
+    current_cost = best_cost;
+    telemetry.count(TM_REHEATS);
+}
+
+//Un paso de Metropolis a la temperatura T actual, sin enfriar,
+// el enfriamiento lo decide quien llama (run o los replicas de ParallelTempering)
+template <class Cost, class Connectivity>
+StepResult BasicSimulatedAnnealing<Cost, Connectivity>::step() {
+    StepResult result = {false, false, 0.0};
+    MoveType type = choose_move_type();
+    telemetry.count(TM_STEPS);
+    telemetry.count((TelemetryCounter)(TM_PROPOSED_SHIFT + type));
     
-    if (found) { // reconstruction
-        std::pair<int, int> current = grid_instance.end;
-        std::vector<std::pair<int, int>> reverse_path;
-        
-        while (!(current.first == grid_instance.start.first && current.second == grid_instance.start.second)) {
-            reverse_path.push_back(current);
-            current = parent[current.second][current.first];
+    Move move;
+    if (type == MOVE_SHIFT) {
+        if (batch_size > 1) return step_batch();
+        move = propose_move(Current_sol); // no copy of the path, always a valid neighbor
+    } else {
+        move = propose_shortening(type);
+        if (move.index < 0) { // nothing to shorten here, not a null move
+            telemetry.count(TM_NOT_APPLICABLE);
+            return result;
         }
-        
-        reverse_path.push_back(grid_instance.start);
-        for (int i = reverse_path.size() - 1; i >= 0; --i) {
-            path.push_back(reverse_path[i]);
+        if (!is_valid_move(Current_sol, move)) { // only the changed cells are checked
+            telemetry.count(TM_INVALID);
+            return result;
         }
-    } else {// BFS
-        for (auto& row : visited) {
-            std::fill(row.begin(), row.end(), false);
+    }
+    return accept_move(move, evaluate_delta(Current_sol, move)); // minimize
+}
+
+//Criterio de Metropolis para un movimiento valido, si se acepta se aplica sobre Current_sol
+template <class Cost, class Connectivity>
+StepResult BasicSimulatedAnnealing<Cost, Connectivity>::accept_move(const Move& move, double delta) {
+    StepResult result = {false, false, delta};
+
+    if (delta < 0 || (double) rng() / rng.max() < std::exp(-delta/T)) { //better sol or SA method
+        apply_move(move);
+        current_cost += delta;
+        result.accepted = true;
+        telemetry.count(TM_ACCEPTED);
+        if (delta > 0) telemetry.count(TM_ACCEPTED_UPHILL);
+    } else {
+        telemetry.count(TM_REJECTED);
+    }
+    if (current_cost < best_cost) { //update if the sol is better - AM
+        Best_sol = Current_sol; // same size, reuses Best_sol storage
+        best_cost = current_cost;
+        result.improved_best = true;
+        telemetry.count(TM_IMPROVED_BEST);
+    }
+    return result;
+}
+
+//Paso con batch_size candidatos evaluados juntos (batch.cpp), cada candidato es un punto y una
+// de sus direcciones legales segun las mascaras de vecinos, como en propose_move. Se elige el
+// primer candidato (el mismo movimiento que propose_move) o el de menor delta, y luego Metropolis.
+// Si ningun punto del lote tiene un movimiento legal el paso es el movimiento nulo de propose_move,
+// aceptado con delta 0, asi batch_size no cambia cuando se enfria
+template <class Cost, class Connectivity>
+StepResult BasicSimulatedAnnealing<Cost, Connectivity>::step_batch() {
+    Move move;
+    move.type = MOVE_SHIFT;
+    move.index = -1;
+    if (Current_sol.size() <= 2) return accept_move(move, 0.0); // like propose_move, nothing to move
+
+    batch.count = std::min(batch_size, (int) MoveBatch::MAX_SIZE);
+    for (int k = 0; k < batch.count; ++k) {
+        int i = rng() % (Current_sol.size() - 2) + 1;
+        const std::pair<int, int>& pos = Current_sol[i];
+        uint8_t legal = grid_instance.masks.free_mask(grid_instance.grid.index(pos.first, pos.second)) &
+                        Connectivity::move_mask(Current_sol[i-1].first - pos.first, Current_sol[i-1].second - pos.second,
+                                                Current_sol[i+1].first - pos.first, Current_sol[i+1].second - pos.second);
+        batch.index[k] = i;
+        batch.old_x[k] = pos.first;
+        batch.old_y[k] = pos.second;
+        batch.new_x[k] = pos.first; // stays, marked invalid below, if the point has no legal move
+        batch.new_y[k] = pos.second;
+        if (legal) {
+            int d = NeighborMasks::nth_direction(legal, rng() % NeighborMasks::count(legal));
+            batch.new_x[k] += NEIGHBOR_OFFSETS[d][0];
+            batch.new_y[k] += NEIGHBOR_OFFSETS[d][1];
         }
-        std::vector<std::pair<int, int>> queue;
-        queue.push_back(grid_instance.start);
-        visited[grid_instance.start.second][grid_instance.start.first] = true;
-        
-        while (!queue.empty() && !found) {
-            std::pair<int, int> current = queue.front();
-            queue.erase(queue.begin());
-            
-            for (const auto& move : moves) {
-                int nx = current.first + move.first;
-                int ny = current.second + move.second;
-                std::pair<int, int> next_pos = {nx, ny};
-                
-                if (is_valid_position(next_pos) && !visited[ny][nx]) {
-                    visited[ny][nx] = true;
-                    parent[ny][nx] = current;
-                    queue.push_back(next_pos);
-                    
-                    if (nx == grid_instance.end.first && ny == grid_instance.end.second) {
-                        found = true;
-                        break;
-                    }
-                }
-            }
+        batch.prev_x[k] = Current_sol[i-1].first;
+        batch.prev_y[k] = Current_sol[i-1].second;
+        batch.next_x[k] = Current_sol[i+1].first;
+        batch.next_y[k] = Current_sol[i+1].second;
+    }
+    if (Cost::BATCH_KERNEL && Connectivity::BATCH_KERNEL) {
+        evaluate_move_batch(grid_instance.grid, batch);
+    } else { // the kernel only knows the euclidean cost with 8 neighbours
+        for (int k = 0; k < batch.count; ++k) {
+            Move candidate;
+            candidate.type = MOVE_SHIFT;
+            candidate.index = batch.index[k];
+            candidate.old_pos = {batch.old_x[k], batch.old_y[k]};
+            candidate.new_pos = {batch.new_x[k], batch.new_y[k]};
+            batch.valid[k] = is_valid_move(Current_sol, candidate);
+            batch.delta[k] = batch.valid[k] ? evaluate_delta(Current_sol, candidate) : 0.0;
         }
-        if (found) { // BFS reconstruction
-            std::pair<int, int> current = grid_instance.end;
-            std::vector<std::pair<int, int>> reverse_path;
-            
-            while (!(current.first == grid_instance.start.first && current.second == grid_instance.start.second)) {
-                reverse_path.push_back(current);
-                current = parent[current.second][current.first];
-            }
-            
-            reverse_path.push_back(grid_instance.start);
-            
-            for (int i = reverse_path.size() - 1; i >= 0; --i) {
-                path.push_back(reverse_path[i]);
-            }
+    }
+    for (int k = 0; k < batch.count; ++k) {
+        if (batch.new_x[k] == batch.old_x[k] && batch.new_y[k] == batch.old_y[k]) batch.valid[k] = 0;
+    }
+
+    int chosen = -1;
+    for (int k = 0; k < batch.count; ++k) {
+        if (!batch.valid[k]) continue;
+        if (batch_selection == BATCH_METROPOLIS) {
+            chosen = k;
+            break;
+        }
+        if (chosen < 0 || batch.delta[k] < batch.delta[chosen]) {
+            chosen = k;
         }
     }
-    std::cout << "Initial sol with " << path.size() << " points" << std::endl;
-    return path;
+    if (chosen < 0) { // no legal move at any point of the batch, the null move of propose_move
+        telemetry.count(TM_NULL_MOVES);
+        return accept_move(move, 0.0);
+    }
+
+    move.index = batch.index[chosen];
+    move.old_pos = {batch.old_x[chosen], batch.old_y[chosen]};
+    move.new_pos = {batch.new_x[chosen], batch.new_y[chosen]};
+    return accept_move(move, batch.delta[chosen]);
+}
+
+const char* stop_reason_name(StopReason reason) {
+    switch (reason) {
+        case STOP_TEMPERATURE: return "temperature";
+        case STOP_DEADLINE: return "deadline";
+        case STOP_ITERATIONS: return "iterations";
+        case STOP_STAGNATION: return "stagnation";
+        default: return "unknown";
+    }
 }
 
 //Run del algoritmo SA con restricciones de camino valido 
-void SimulatedAnnealing::run(bool print_progress) {
-    double current_cost = evaluate_cost(Current_sol);
-    double best_cost = evaluate_cost(Best_sol);
-    int iterations = 0;// just as a meassure, the stopping condition is the temp_threshold
-    
-    if (!is_valid_path(Current_sol)) {
-        if (print_progress) {
-            std::cout << "Initial sol not valid" << std::endl;
+template <class Cost, class Connectivity>
+void BasicSimulatedAnnealing<Cost, Connectivity>::run(bool print_progress) {
+    run_anytime(RunLimits(), nullptr, print_progress); // no limits, same loop and same results
+}
+
+//Run con limites de tiempo, iteraciones y estancamiento, ademas de la temperatura.
+// Cada mejora de Best_sol se pasa a on_improvement, y al terminar Best_sol es el mejor camino
+// valido encontrado. El reloj se lee cada CLOCK_CHECK_INTERVAL iteraciones
+template <class Cost, class Connectivity>
+StopReason BasicSimulatedAnnealing<Cost, Connectivity>::run_anytime(const RunLimits& limits,
+                                                                   const ImprovementCallback& on_improvement,
+                                                                   bool print_progress) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(limits.time_budget_ms));
+    bool timed = limits.time_budget_ms > 0.0;
+
+    prepare_run(print_progress);
+    if (schedule.initial_samples > 0) { // temperatures on the scale of the cost deltas
+        double mean_delta = sample_uphill_delta(schedule.initial_samples);
+        if (mean_delta > 0) {
+            T = -mean_delta / std::log(schedule.initial_acceptance);
+            temp_threshold = -mean_delta / std::log(schedule.final_acceptance);
         }
-        Current_sol = generate_initial_path();
-        Best_sol = Current_sol;
-        current_cost = evaluate_cost(Current_sol);
-        best_cost = current_cost;
     }
+    schedule.start(T, cooling_rate, temp_threshold);
+    // iterations is just a meassure, the stopping condition is the temp_threshold
+    PhaseTimer timer(telemetry, PHASE_ANNEAL);
+    telemetry.record(iterations, T, current_cost, best_cost);
+    if (on_improvement) on_improvement(Best_sol, best_cost, iterations);
+    long last_improvement = 0;
+    long last_reheat = 0;
+    stop_reason = STOP_TEMPERATURE;
 
-    while (T > temp_threshold){ //end when temperature is low enough
-        iterations++;
-        std::vector<std::pair<int, int>> neighbor = generate_neighbor(Current_sol);
-        if (!is_valid_path(neighbor)) { // valid neighbor
-            continue;
+    for (;;) {
+        if (T <= temp_threshold) { //end when temperature is low enough
+            if (!schedule.can_reheat()) break;
+            reheat();
+            last_reheat = iterations;
+        }
+        if (limits.max_iterations > 0 && iterations >= limits.max_iterations) {
+            stop_reason = STOP_ITERATIONS;
+            break;
+        }
+        if (timed && iterations % CLOCK_CHECK_INTERVAL == 0 && Clock::now() >= deadline) {
+            stop_reason = STOP_DEADLINE;
+            break;
         }
+        iterations++;
+        StepResult result = step();
         
-        double neighbor_cost = evaluate_cost(neighbor);
-        double delta = neighbor_cost - current_cost; // minimize
-        bool accepted = false;
-
-        if (delta < 0 || (double) rand() / RAND_MAX < std::exp(-delta/T)) { //better sol or SA method
-            Current_sol = neighbor;
-            current_cost = neighbor_cost;
-            T = delta < 0 ? T : T * cooling_rate; //only cool if we accepted a worse solution
-            accepted = true;
-        } 
-        if (current_cost < best_cost) { //update if the sol is better - AM
-            Best_sol = Current_sol;
-            best_cost = current_cost;
-            
-            if (print_progress && (iterations % 100 == 0 || best_cost < current_cost)) { //verbose
-                std::cout << "Iteration " << iterations 
-                          << ", Path Length: " << Best_sol.size() 
-                          << ", Best cost: " << best_cost 
-                          << ", Temperature: " << T << std::endl;
-            }
+        double next_T = schedule.update(T, result.accepted, result.delta);
+        if (next_T != T) {
+            T = next_T;
+            telemetry.count(TM_COOLINGS);
+        }
+        telemetry.sample(iterations, T, current_cost, best_cost);
+        if (result.improved_best) {
+            last_improvement = iterations;
+            if (on_improvement) on_improvement(Best_sol, best_cost, iterations);
+        }
+        if (result.improved_best && print_progress && (iterations % 100 == 0 || best_cost < current_cost)) { //verbose
+            std::cout << "Iteration " << iterations 
+                      << ", Path Length: " << Best_sol.size() 
+                      << ", Best cost: " << best_cost 
+                      << ", Temperature: " << T << "\n";
+        }
+        if (limits.stagnation_window > 0 && iterations - last_improvement >= limits.stagnation_window) {
+            stop_reason = STOP_STAGNATION;
+            break;
+        }
+        if (schedule.reheat_window > 0 && schedule.can_reheat() &&
+            iterations - std::max(last_improvement, last_reheat) >= schedule.reheat_window) {
+            reheat();
+            last_reheat = iterations;
         }
     }
     
+    telemetry.record(iterations, T, current_cost, best_cost); // final state
+    
     if (print_progress) {
-        std::cout << "\nSimulated Annealing completed with " << iterations << " iterations." << std::endl;
-        std::cout << "Final path length: " << Best_sol.size() << " points" << std::endl;
-        std::cout << "Final temperature: " << T << std::endl;
+        std::cout << "\nSimulated Annealing completed with " << iterations << " iterations"
+                  << " (stopped by " << stop_reason_name(stop_reason) << ").\n";
+        std::cout << "Final path length: " << Best_sol.size() << " points\n";
+        std::cout << "Final temperature: " << T << " (" << cooling_kind_name(schedule.kind) << " cooling, "
+                  << schedule.reheats << " reheats)\n";
         
         if (!is_valid_path(Best_sol)) {
-            std::cout << "Final sol not valid" << std::endl;
+            std::cout << "Final sol not valid\n";
         } 
     }
+    return stop_reason;
 }
 
+//Aplica un lote de cambios de celdas a la solucion en curso, sin reconstruir el annealer: el grid
+// y las mascaras se copian solo si estan compartidos, y se actualizan solo alrededor de cada celda.
+// Luego repara Current_sol y Best_sol (repair_path), asi el recocido sigue desde donde estaba
+template <class Cost, class Connectivity>
+bool BasicSimulatedAnnealing<Cost, Connectivity>::update_cells(const std::vector<CellChange>& changes) {
+    static thread_local SearchContext thread_context;
+    OccupancyGrid& grid = grid_instance.grid;
+    for (const CellChange& change : changes) {
+        if (!grid.in_bounds(change.x, change.y) || grid.blocked(change.x, change.y) == change.blocked) continue;
+        grid.set_blocked(change.x, change.y, change.blocked);
+        grid_instance.masks.update(grid, change.x, change.y);
+        cost_policy.update(grid, change.x, change.y);
+    }
+    if (!is_valid_position(grid_instance.start) || !is_valid_position(grid_instance.end)) return false;
+
+    SearchContext& context = search_context ? *search_context : thread_context;
+    bool same = Best_sol == Current_sol;
+    if (!repair_path(Current_sol, context)) return false;
+    if (same) {
+        Best_sol = Current_sol;
+    } else if (!repair_path(Best_sol, context)) {
+        return false;
+    }
+    current_cost = evaluate_cost(Current_sol);
+    best_cost = evaluate_cost(Best_sol);
+    if (current_cost < best_cost) { // a cleared cell can only lower costs, a detour raises them
+        Best_sol = Current_sol;
+        best_cost = current_cost;
+    }
+    return true;
+}
+
+//Repara un camino tras cambios del grid: cada tramo con puntos bloqueados (o pasos que ya no son
+// adyacentes) se reemplaza por un desvio A* entre el ultimo punto valido antes del tramo y el primero
+// despues. El desvio se busca en el rectangulo del tramo con repair_radius celdas de margen y luego
+// con 4 veces ese margen. Si tampoco alcanza se busca en todo el grid un resto nuevo hasta el final
+template <class Cost, class Connectivity>
+bool BasicSimulatedAnnealing<Cost, Connectivity>::repair_path(std::vector<std::pair<int, int>>& path,
+                                                              SearchContext& context) {
+    if (path.empty() || path.front() != grid_instance.start || path.back() != grid_instance.end) return false;
+    size_t i = 0;
+    while (i < path.size() && is_valid_position(path[i]) && (i == 0 || Connectivity::adjacent(path[i - 1], path[i]))) {
+        i++;
+    }
+    if (i == path.size()) return true; // untouched, the common case
+    if (i == 0) return false; // start blocked
+
+    const OccupancyGrid& grid = grid_instance.grid;
+    std::vector<std::pair<int, int>> repaired(path.begin(), path.begin() + i);
+    std::vector<std::pair<int, int>> detour;
+    while (i < path.size()) {
+        if (is_valid_position(path[i]) && Connectivity::adjacent(repaired.back(), path[i])) {
+            repaired.push_back(path[i++]);
+            continue;
+        }
+        // path[i] is blocked or cut from the kept points, rejoin at the next free point (the end is free)
+        size_t j = i;
+        while (!is_valid_position(path[j])) j++;
+        int x0 = std::min(repaired.back().first, path[j].first), x1 = std::max(repaired.back().first, path[j].first);
+        int y0 = std::min(repaired.back().second, path[j].second), y1 = std::max(repaired.back().second, path[j].second);
+        for (size_t k = i; k < j; ++k) {
+            x0 = std::min(x0, path[k].first);
+            x1 = std::max(x1, path[k].first);
+            y0 = std::min(y0, path[k].second);
+            y1 = std::max(y1, path[k].second);
+        }
+        // A* whatever seed_method is, a DFS detour would wander away from the path
+        bool found = false;
+        for (int radius = std::max(1, repair_radius); radius <= 4 * std::max(1, repair_radius) && !found; radius *= 4) {
+            context.begin_corridor(grid.padded_cells());
+            for (int y = std::max(0, y0 - radius); y <= std::min(grid.rows() - 1, y1 + radius); ++y) {
+                for (int x = std::max(0, x0 - radius); x <= std::min(grid.cols() - 1, x1 + radius); ++x) {
+                    context.add_to_corridor(grid.index(x, y));
+                }
+            }
+            found = find_path(grid, repaired.back(), path[j], SEED_ASTAR, context, detour, Connectivity::DEGREE);
+            context.end_corridor();
+            telemetry.count(TM_REPAIRS);
+        }
+        if (!found) { // path[j] walled in or the way around is long, search a new rest of the path
+            j = path.size() - 1;
+            found = find_path(grid, repaired.back(), path[j], SEED_ASTAR, context, detour, Connectivity::DEGREE);
+            telemetry.count(TM_REPAIRS);
+            if (!found) return false;
+        }
+        repaired.insert(repaired.end(), detour.begin() + 1, detour.end());
+        i = j + 1;
+    }
+    path.swap(repaired);
+    return true;
+}
+
+//Sigue el recocido tras update_cells con un enfriamiento corto: parte de reheat_fraction del T inicial
+// del ultimo run (sin volver a estimarlo) y del estado reparado, no de un camino nuevo
+template <class Cost, class Connectivity>
+StopReason BasicSimulatedAnnealing<Cost, Connectivity>::run_warm(const RunLimits& limits,
+                                                                const ImprovementCallback& on_improvement) {
+    double initial_T = schedule.initial_T;
+    int initial_samples = schedule.initial_samples;
+    if (initial_T > 0.0) { // else nothing ran yet, a normal run
+        T = initial_T * schedule.reheat_fraction;
+        schedule.initial_samples = 0;
+    }
+    StopReason reason = run_anytime(limits, on_improvement);
+    schedule.initial_samples = initial_samples;
+    if (initial_T > 0.0) schedule.initial_T = initial_T; // the next warm run starts as high as this one
+    return reason;
+}
 
+template class BasicSimulatedAnnealing<EuclideanCost, EightConnected>;
+template class BasicSimulatedAnnealing<EuclideanCost, FourConnected>;
+template class BasicSimulatedAnnealing<ManhattanCost, EightConnected>;
+template class BasicSimulatedAnnealing<ManhattanCost, FourConnected>;
+template class BasicSimulatedAnnealing<ClearanceCost, EightConnected>;
+template class BasicSimulatedAnnealing<ClearanceCost, FourConnected>;
+template class BasicSimulatedAnnealing<TurnPenaltyCost, EightConnected>;
+template class BasicSimulatedAnnealing<TurnPenaltyCost, FourConnected>;
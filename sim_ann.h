@@ -6,39 +6,181 @@
 #include <cmath>
 #include <random>
 #include <limits>
+#include <functional>
+#include "grid.h"
+#include "batch.h"
+#include "search.h"
+#include "neighbors.h"
+#include "telemetry.h"
+#include "policies.h"
+#include "schedule.h"
 
 struct GridInstance {
-    std::vector<std::vector<int>> grid;
+    OccupancyGrid grid; // obstacles only, start and end are kept below
     std::pair<int, int> start;
     std::pair<int, int> end;
     int rows;
     int cols;
+    // Free neighbours of each cell, built by SimulatedAnnealing if missing. One byte per cell,
+    // so with a BITMAP grid the masks take 8 times the grid (16 MB on 4096x4096 next to 2 MB):
+    // the price of sampling every shift move without retries
+    NeighborMasks masks;
 };
 
-class SimulatedAnnealing {
+//Tipos de movimiento, los de acortamiento cambian el numero de puntos del camino
+enum MoveType {
+    MOVE_SHIFT,        // one interior point to a neighbour cell (the original move)
+    MOVE_REMOVE_POINT, // drop a point whose neighbours are already connected
+    MOVE_SPLICE_LOOP,  // cut the points between two connected points of the path
+    MOVE_SHORTCUT,     // replace a sub-segment with a straight run with the connectivity of the path
+    NUM_MOVE_TYPES
+};
+
+//Movimiento sobre el camino, para evaluar el vecino de forma incremental
+struct Move {
+    MoveType type;
+    int index; // -1 when the neighbor is identical to the path
+               // shift: the moved point, others: first replaced point
+    int end;   // others: one past the last replaced point, the new points are in move_points
+    std::pair<int, int> old_pos; // shift only
+    std::pair<int, int> new_pos;
+};
+
+//Como se elige el candidato en un paso con lote de movimientos (batch_size > 1)
+enum BatchSelection {
+    BATCH_METROPOLIS, // first valid candidate, then Metropolis
+    BATCH_BEST_OF_K   // candidate with the lowest delta, then Metropolis
+};
+
+//Resultado de un paso de Metropolis (BasicSimulatedAnnealing::step)
+struct StepResult {
+    bool accepted;
+    bool improved_best;
+    double delta; // cost change of the proposed move, 0 if it was not valid
+};
+
+//Limites de una corrida anytime (run_anytime), 0 = sin limite. La corrida termina con el
+// primero que se cumpla, o cuando T llega a temp_threshold como en run() (y no quedan recalentamientos)
+struct RunLimits {
+    double time_budget_ms;  // wall-clock budget from the call, checked every CLOCK_CHECK_INTERVAL iterations
+    long max_iterations;
+    long stagnation_window; // iterations without improving Best_sol
+
+    RunLimits() : time_budget_ms(0.0), max_iterations(0), stagnation_window(0) {}
+};
+
+enum StopReason {
+    STOP_TEMPERATURE, // T <= temp_threshold, the only condition of run()
+    STOP_DEADLINE,
+    STOP_ITERATIONS,
+    STOP_STAGNATION
+};
+
+const char* stop_reason_name(StopReason reason);
+
+//Cambio de una celda del grid para update_cells
+struct CellChange {
+    int x;
+    int y;
+    bool blocked; // true = new obstacle, false = cleared cell
+};
+
+//Se llama con cada nuevo Best_sol (la referencia solo es valida durante la llamada)
+typedef std::function<void(const std::vector<std::pair<int, int>>& best, double best_cost, long iteration)>
+    ImprovementCallback;
+
+//Simulated Annealing sobre un camino del grid, con el costo (Cost) y la conectividad
+// (Connectivity) como politicas de compilacion, ver policies.h. Las combinaciones disponibles
+// se instancian en sim_ann.cpp, SimulatedAnnealing es la original (euclidiano, 8 vecinos)
+template <class Cost, class Connectivity>
+class BasicSimulatedAnnealing {
 public: // all public for easy access
+    typedef Cost CostPolicy;
+    typedef Connectivity ConnectivityPolicy;
 
     //Parametros
     double T;
     double cooling_rate;
     double temp_threshold; // stopping condition
+    CoolingSchedule schedule; // how T goes down during run(), the original geometric one by default
     std::vector<std::pair<int, int>> Best_sol;
     std::vector<std::pair<int, int>> Current_sol;
     GridInstance grid_instance; 
     unsigned random_seed;
+    std::mt19937 rng; // per instance engine, no global rand() state so runs can go in parallel
+    Move last_move; // move applied by the last call to generate_neighbor
+    double current_cost; // cost of Current_sol, kept up to date by step()
+    double best_cost;    // cost of Best_sol
+    long iterations;
+    int batch_size; // candidates evaluated together per step, 1 = single move from propose_move
+    BatchSelection batch_selection;
+    MoveBatch batch; // reused by every step, no allocation
+    double move_weights[NUM_MOVE_TYPES]; // selection weight of each move type
+    int shortening_window; // max points spanned by splice and shortcut moves, under 2 they never apply
+    std::vector<std::pair<int, int>> move_points;    // new points of the last shortening move
+    std::vector<std::pair<int, int>> removed_points; // points removed by the last apply_move
+    SeedMethod seed_method; // used by generate_initial_path
+    SearchContext* search_context; // scratch for generate_initial_path, nullptr = one per thread
+    Telemetry telemetry; // counters and trace, empty unless built with SA_TELEMETRY
+    StopReason stop_reason; // why the last run ended
+    Cost cost_policy; // parameters of the cost, prepared for grid_instance by init()
+    std::vector<std::pair<int, int>> delta_window; // scratch of evaluate_delta for costs with turns
+    int repair_radius; // cells around a broken stretch of the path where update_cells first looks for a detour
+
+    static const int CLOCK_CHECK_INTERVAL = 64; // iterations between clock reads in run_anytime
 
     //Constructor
-    SimulatedAnnealing(double T, double cooling_rate, double temp_threshold, 
-                       const GridInstance& grid_inst);
+    BasicSimulatedAnnealing(double T, double cooling_rate, double temp_threshold, 
+                            const GridInstance& grid_inst);
+    BasicSimulatedAnnealing(double T, double cooling_rate, double temp_threshold, 
+                            const GridInstance& grid_inst,
+                            const std::vector<std::pair<int, int>>& initial_path); // skips generate_initial_path
 
     //Funciones
+    void init(double T, double cooling_rate, double temp_threshold, const GridInstance& grid_inst);
     bool is_valid_position(const std::pair<int, int>& pos);
     bool is_valid_path(const std::vector<std::pair<int, int>>& path);
     std::vector<std::pair<int, int>> generate_initial_path();
     double evaluate_cost(const std::vector<std::pair<int, int>>& path);
+    static int chebyshev(const std::pair<int, int>& a, const std::pair<int, int>& b);
+    double segment_cost(const std::pair<int, int>& a, const std::pair<int, int>& b);
+    double window_cost(const std::pair<int, int>* points, size_t count); // segments and turns inside
+    bool is_valid_move(const std::vector<std::pair<int, int>>& path, const Move& move);
+    double evaluate_delta(const std::vector<std::pair<int, int>>& path, const Move& move);
     std::vector<std::pair<int, int>> generate_neighbor(const std::vector<std::pair<int, int>>& path);
+    Move propose_move(const std::vector<std::pair<int, int>>& path);
+    void apply_move(const Move& move);  // in place on Current_sol
+    void revert_move(const Move& move); // undo of apply_move on Current_sol
+    Move propose_shortening(MoveType type);
+    MoveType choose_move_type();
+    void prepare_run(bool print_progress = false);
+    double sample_uphill_delta(int samples); // mean cost increase of sampled valid moves, 0 if none
+    void reheat(); // T from schedule.reheat(), the chain continues from Best_sol
+    StepResult step();
+    StepResult accept_move(const Move& move, double delta);
+    StepResult step_batch();
     void run(bool print_progress = true);
+    StopReason run_anytime(const RunLimits& limits, const ImprovementCallback& on_improvement = nullptr,
+                           bool print_progress = false);
     void set_random_seed(unsigned seed);
+
+    // Applies the changes to the grid, masks and cost, then repairs Current_sol and Best_sol.
+    // False if start or end got blocked or the end can no longer be reached
+    bool update_cells(const std::vector<CellChange>& changes);
+    bool repair_path(std::vector<std::pair<int, int>>& path, SearchContext& context);
+    StopReason run_warm(const RunLimits& limits, const ImprovementCallback& on_improvement = nullptr);
 };
 
+typedef BasicSimulatedAnnealing<EuclideanCost, EightConnected> SimulatedAnnealing;
+
+// Instantiated in sim_ann.cpp
+extern template class BasicSimulatedAnnealing<EuclideanCost, EightConnected>;
+extern template class BasicSimulatedAnnealing<EuclideanCost, FourConnected>;
+extern template class BasicSimulatedAnnealing<ManhattanCost, EightConnected>;
+extern template class BasicSimulatedAnnealing<ManhattanCost, FourConnected>;
+extern template class BasicSimulatedAnnealing<ClearanceCost, EightConnected>;
+extern template class BasicSimulatedAnnealing<ClearanceCost, FourConnected>;
+extern template class BasicSimulatedAnnealing<TurnPenaltyCost, EightConnected>;
+extern template class BasicSimulatedAnnealing<TurnPenaltyCost, FourConnected>;
+
 #endif // SIM_ANN_H
@@ -0,0 +1,70 @@
+#include "telemetry.h"
+#include <iomanip>
+
+const char* telemetry_counter_name(TelemetryCounter counter) {
+    static const char* names[NUM_TELEMETRY_COUNTERS] = {
+        "steps", "proposed_shift", "proposed_remove_point", "proposed_splice_loop", "proposed_shortcut",
+        "null_moves", "not_applicable", "invalid", "accepted", "accepted_uphill", "rejected",
+        "improved_best", "coolings", "reheats", "repairs"
+    };
+    return names[counter];
+}
+
+const char* telemetry_phase_name(TelemetryPhase phase) {
+    static const char* names[NUM_TELEMETRY_PHASES] = {"seed_ms", "anneal_ms"};
+    return names[phase];
+}
+
+#ifdef SA_TELEMETRY
+
+void write_telemetry_header(std::ostream& summary, std::ostream& trace, TelemetryFormat format) {
+    if (format != TELEMETRY_CSV) return; // JSON lines have no header
+
+    summary << "instance_name,run,seed";
+    for (int c = 0; c < NUM_TELEMETRY_COUNTERS; ++c) summary << "," << telemetry_counter_name((TelemetryCounter) c);
+    for (int p = 0; p < NUM_TELEMETRY_PHASES; ++p) summary << "," << telemetry_phase_name((TelemetryPhase) p);
+    summary << "\n";
+    trace << "instance_name,run,iteration,temperature,current_cost,best_cost,acceptance\n";
+}
+
+void write_telemetry_run(std::ostream& summary, std::ostream& trace, TelemetryFormat format,
+                         const std::string& instance_name, int run, unsigned seed, const Telemetry& telemetry) {
+    if (format == TELEMETRY_CSV) {
+        summary << instance_name << "," << run << "," << seed;
+        for (int c = 0; c < NUM_TELEMETRY_COUNTERS; ++c) summary << "," << telemetry.counters[c];
+        for (int p = 0; p < NUM_TELEMETRY_PHASES; ++p) {
+            summary << "," << std::fixed << std::setprecision(4) << telemetry.phase_ms[p];
+        }
+        summary << "\n";
+        for (const TraceSample& s : telemetry.trace) {
+            trace << instance_name << "," << run << "," << s.iteration << ","
+                  << std::fixed << std::setprecision(6) << s.T << "," << std::setprecision(4) << s.current_cost << ","
+                  << s.best_cost << "," << s.acceptance << "\n";
+        }
+        return;
+    }
+
+    summary << "{\"instance_name\":\"" << instance_name << "\",\"run\":" << run << ",\"seed\":" << seed;
+    for (int c = 0; c < NUM_TELEMETRY_COUNTERS; ++c) {
+        summary << ",\"" << telemetry_counter_name((TelemetryCounter) c) << "\":" << telemetry.counters[c];
+    }
+    for (int p = 0; p < NUM_TELEMETRY_PHASES; ++p) {
+        summary << ",\"" << telemetry_phase_name((TelemetryPhase) p) << "\":"
+                << std::fixed << std::setprecision(4) << telemetry.phase_ms[p];
+    }
+    summary << ",\"trace\":[";
+    for (size_t k = 0; k < telemetry.trace.size(); ++k) {
+        const TraceSample& s = telemetry.trace[k];
+        summary << (k ? "," : "") << "[" << s.iteration << "," << std::setprecision(6) << s.T << ","
+                << std::setprecision(4) << s.current_cost << "," << s.best_cost << "," << s.acceptance << "]";
+    }
+    summary << "]}\n";
+}
+
+#else
+
+void write_telemetry_header(std::ostream&, std::ostream&, TelemetryFormat) {}
+void write_telemetry_run(std::ostream&, std::ostream&, TelemetryFormat, const std::string&, int, unsigned,
+                         const Telemetry&) {}
+
+#endif // SA_TELEMETRY
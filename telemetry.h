@@ -0,0 +1,135 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <chrono>
+
+//Instrumentacion del ciclo de SA, se activa al compilar con -DSA_TELEMETRY (make TELEMETRY=1).
+// Sin la macro Telemetry no tiene datos y todos sus metodos son vacios, el compilador
+// los elimina y el ciclo queda igual que sin instrumentacion.
+// Los contadores son de cada SimulatedAnnealing, que corre en un solo hilo, asi no hay atomicos
+
+//Contadores del ciclo
+enum TelemetryCounter {
+    TM_STEPS,                  // calls to step()
+    TM_PROPOSED_SHIFT,         // proposals per move type, same order as MoveType
+    TM_PROPOSED_REMOVE_POINT,
+    TM_PROPOSED_SPLICE_LOOP,
+    TM_PROPOSED_SHORTCUT,
+    TM_NULL_MOVES,             // shift without a legal move, the neighbor is the unchanged path
+    TM_NOT_APPLICABLE,         // shortening move with nothing to shorten at the chosen point
+    TM_INVALID,                // rejected by is_valid_move, or a batch without a valid candidate
+    TM_ACCEPTED,
+    TM_ACCEPTED_UPHILL,        // accepted with delta > 0
+    TM_REJECTED,
+    TM_IMPROVED_BEST,
+    TM_COOLINGS,
+    TM_REHEATS,                // reheats of the cooling schedule (schedule.h)
+    TM_REPAIRS,                // detour searches of update_cells
+    NUM_TELEMETRY_COUNTERS
+};
+
+//Fases con tiempo medido
+enum TelemetryPhase {
+    PHASE_SEED,   // initial path search
+    PHASE_ANNEAL, // the run() loop
+    NUM_TELEMETRY_PHASES
+};
+
+enum TelemetryFormat {
+    TELEMETRY_CSV,  // one file of counters per run and one file with the traces
+    TELEMETRY_JSON  // one JSON object per line and per run, with its trace
+};
+
+//Muestra de la traza cada trace_every iteraciones
+struct TraceSample {
+    long iteration;
+    double T;
+    double current_cost;
+    double best_cost;
+    double acceptance; // accepted / steps since the previous sample
+};
+
+const char* telemetry_counter_name(TelemetryCounter counter);
+const char* telemetry_phase_name(TelemetryPhase phase);
+
+class Telemetry {
+public:
+#ifdef SA_TELEMETRY
+    static const bool enabled = true;
+
+    Telemetry() : trace_every(100), last_steps_(0), last_accepted_(0) {
+        for (int c = 0; c < NUM_TELEMETRY_COUNTERS; ++c) counters[c] = 0;
+        for (int p = 0; p < NUM_TELEMETRY_PHASES; ++p) phase_ms[p] = 0.0;
+    }
+
+    void count(TelemetryCounter counter) { counters[counter]++; }
+    void add_phase(TelemetryPhase phase, double ms) { phase_ms[phase] += ms; }
+    double phase(TelemetryPhase phase) const { return phase_ms[phase]; }
+    void set_trace_every(int every) { trace_every = every; }
+
+    void sample(long iteration, double T, double current_cost, double best_cost) {
+        if (trace_every > 0 && iteration % trace_every == 0) {
+            record(iteration, T, current_cost, best_cost);
+        }
+    }
+    void record(long iteration, double T, double current_cost, double best_cost) {
+        long steps = counters[TM_STEPS] - last_steps_;
+        long accepted = counters[TM_ACCEPTED] - last_accepted_;
+        TraceSample sample = {iteration, T, current_cost, best_cost, steps > 0 ? (double) accepted / steps : 0.0};
+        trace.push_back(sample);
+        last_steps_ = counters[TM_STEPS];
+        last_accepted_ = counters[TM_ACCEPTED];
+    }
+
+    long counters[NUM_TELEMETRY_COUNTERS];
+    double phase_ms[NUM_TELEMETRY_PHASES];
+    std::vector<TraceSample> trace;
+    int trace_every; // 0 = no trace
+
+private:
+    long last_steps_;
+    long last_accepted_;
+#else
+    static const bool enabled = false;
+
+    void count(TelemetryCounter) {}
+    void add_phase(TelemetryPhase, double) {}
+    double phase(TelemetryPhase) const { return 0.0; }
+    void set_trace_every(int) {}
+    void sample(long, double, double, double) {}
+    void record(long, double, double, double) {}
+#endif
+};
+
+//Mide una fase mientras existe, sin telemetria no lee el reloj
+class PhaseTimer {
+public:
+#ifdef SA_TELEMETRY
+    PhaseTimer(Telemetry& telemetry, TelemetryPhase phase)
+        : telemetry_(telemetry), phase_(phase), start_(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        telemetry_.add_phase(phase_, std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    Telemetry& telemetry_;
+    TelemetryPhase phase_;
+    std::chrono::steady_clock::time_point start_;
+#else
+    PhaseTimer(Telemetry&, TelemetryPhase) {}
+#endif
+};
+
+//Exportacion de la telemetria de cada simulacion, sin SA_TELEMETRY no escriben nada.
+// En CSV summary recibe una fila de contadores por run y trace una fila por muestra,
+// en JSON todo va a summary y trace no se usa, cada muestra es
+// [iteration, temperature, current_cost, best_cost, acceptance]
+void write_telemetry_header(std::ostream& summary, std::ostream& trace, TelemetryFormat format);
+void write_telemetry_run(std::ostream& summary, std::ostream& trace, TelemetryFormat format,
+                         const std::string& instance_name, int run, unsigned seed, const Telemetry& telemetry);
+
+#endif // TELEMETRY_H
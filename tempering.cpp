@@ -0,0 +1,123 @@
+#include "tempering.h"
+#include "parallel.h"
+#include <thread>
+#include <cmath>
+#include <random>
+#include <iostream>
+
+//Crea las replicas, todas parten del mismo camino inicial y con semillas derivadas de seed.
+// Sus temperaturas las pone build_ladder al inicio de run()
+template <class Cost, class Connectivity>
+BasicParallelTempering<Cost, Connectivity>::BasicParallelTempering(const GridInstance& grid_inst,
+                                                                   const std::vector<std::pair<int, int>>& initial_path,
+                                                                   int num_replicas, unsigned seed)
+    : ladder_samples(200), T_min(1.0), T_max(1.0) {
+    std::mt19937 seeds(seed);
+    for (int r = 0; r < num_replicas; ++r) {
+        // cooling_rate and temp_threshold are not used, the replicas never cool
+        replicas.push_back(std::unique_ptr<Annealer>(new Annealer(1.0, 1.0, 0.0, grid_inst, initial_path)));
+        replicas[r]->set_random_seed(seeds());
+    }
+    best_cost = 0.0;
+    swaps_attempted = 0;
+    swaps_accepted = 0;
+}
+
+//Temperaturas T_min * (T_max / T_min)^(r / (n - 1)), con T = -delta medio / ln(aceptacion) en
+// cada extremo. Si ningun movimiento de muestra sube el costo se dejan las del run anterior
+template <class Cost, class Connectivity>
+void BasicParallelTempering<Cost, Connectivity>::build_ladder() {
+    Annealer& coldest = *replicas[0];
+    int samples = coldest.schedule.initial_samples > 0 ? coldest.schedule.initial_samples : ladder_samples;
+    double mean_delta = coldest.sample_uphill_delta(samples);
+    if (mean_delta > 0) {
+        T_min = -mean_delta / std::log(coldest.schedule.final_acceptance);
+        T_max = -mean_delta / std::log(coldest.schedule.initial_acceptance);
+    }
+    int n = replicas.size();
+    for (int r = 0; r < n; ++r) {
+        double ratio = n > 1 ? (double) r / (n - 1) : 0.0;
+        replicas[r]->T = T_min * std::pow(T_max / T_min, ratio);
+    }
+}
+
+//Intercambio de caminos entre dos replicas vecinas, se acepta con probabilidad
+// min(1, exp((E_frio - E_caliente) * (1/T_frio - 1/T_caliente))).
+// Solo se intercambian los vectores (sin copiar los puntos) y sus costos
+template <class Cost, class Connectivity>
+bool BasicParallelTempering<Cost, Connectivity>::exchange(int lower) {
+    Annealer& cold = *replicas[lower];
+    Annealer& hot = *replicas[lower + 1];
+
+    double x = (cold.current_cost - hot.current_cost) * (1.0 / cold.T - 1.0 / hot.T);
+    if (x >= 0 || (double) cold.rng() / cold.rng.max() < std::exp(x)) {
+        std::swap(cold.Current_sol, hot.Current_sol);
+        std::swap(cold.current_cost, hot.current_cost);
+        return true;
+    }
+    return false;
+}
+
+//Cada replica corre en su propio hilo. Despues de cada bloque de pasos hay una barrera,
+// se intercambian los pares (0,1),(2,3),... o (1,2),(3,4),... alternando en cada ronda,
+// y otra barrera antes del siguiente bloque. Cada par lo resuelve el hilo de la replica
+// mas fria con su propio generador, asi el resultado solo depende de la semilla.
+// Los costos se calculan aqui, despues de que quien llama configura las replicas
+template <class Cost, class Connectivity>
+void BasicParallelTempering<Cost, Connectivity>::run(int num_exchanges, int steps_per_exchange, bool print_progress) {
+    int n = replicas.size();
+    for (auto& replica : replicas) replica->prepare_run();
+    build_ladder();
+    Best_sol = replicas[0]->Best_sol;
+    best_cost = replicas[0]->best_cost;
+    SpinBarrier barrier(n);
+    std::vector<long> attempted(n, 0);
+    std::vector<long> accepted(n, 0);
+
+    auto replica_loop = [&](int r) {
+        Annealer& replica = *replicas[r];
+        for (int round = 0; round < num_exchanges; ++round) {
+            for (int k = 0; k < steps_per_exchange; ++k) {
+                replica.iterations++;
+                replica.step();
+            }
+            barrier.wait();
+            if (r % 2 == round % 2 && r + 1 < n) {
+                attempted[r]++;
+                if (exchange(r)) accepted[r]++;
+            }
+            barrier.wait();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int r = 1; r < n; ++r) {
+        threads.push_back(std::thread(replica_loop, r));
+    }
+    replica_loop(0);
+    for (auto& t : threads) t.join();
+
+    for (int r = 0; r < n; ++r) {
+        swaps_attempted += attempted[r];
+        swaps_accepted += accepted[r];
+        if (replicas[r]->best_cost < best_cost) {
+            best_cost = replicas[r]->best_cost;
+            Best_sol = replicas[r]->Best_sol;
+        }
+    }
+
+    if (print_progress) {
+        std::cout << "Parallel tempering with " << n << " replicas from T = " << T_min << " to " << T_max
+                  << ", best cost: " << best_cost
+                  << ", swaps accepted: " << swaps_accepted << " of " << swaps_attempted << std::endl;
+    }
+}
+
+template class BasicParallelTempering<EuclideanCost, EightConnected>;
+template class BasicParallelTempering<EuclideanCost, FourConnected>;
+template class BasicParallelTempering<ManhattanCost, EightConnected>;
+template class BasicParallelTempering<ManhattanCost, FourConnected>;
+template class BasicParallelTempering<ClearanceCost, EightConnected>;
+template class BasicParallelTempering<ClearanceCost, FourConnected>;
+template class BasicParallelTempering<TurnPenaltyCost, EightConnected>;
+template class BasicParallelTempering<TurnPenaltyCost, FourConnected>;
@@ -0,0 +1,54 @@
+#ifndef TEMPERING_H
+#define TEMPERING_H
+
+#include <vector>
+#include <utility>
+#include <memory>
+#include "sim_ann.h"
+
+//Parallel tempering (replica exchange): varias cadenas de BasicSimulatedAnnealing a temperaturas
+// fijas en una escala geometrica, cada una en su hilo. Cada steps_per_exchange pasos las
+// replicas vecinas intercambian sus caminos con el criterio de Metropolis. Las replicas son
+// publicas para configurarlas (movimientos, lotes...) antes de run(), como un annealer normal.
+//
+// La escala se estima al inicio de run() con la media de los deltas cuesta arriba de movimientos
+// de muestra, como CoolingSchedule: la replica mas fria acepta un movimiento cuesta arriba medio
+// con probabilidad schedule.final_acceptance y la mas caliente con schedule.initial_acceptance
+template <class Cost, class Connectivity>
+class BasicParallelTempering {
+public: // all public for easy access, like BasicSimulatedAnnealing
+    typedef BasicSimulatedAnnealing<Cost, Connectivity> Annealer;
+
+    int ladder_samples; // sampled moves for the ladder when the replicas have no schedule.initial_samples
+    std::vector<std::unique_ptr<Annealer>> replicas; // replicas[0] is the coldest
+    double T_min; // ladder of the last run
+    double T_max;
+    std::vector<std::pair<int, int>> Best_sol;
+    double best_cost;
+    long swaps_attempted;
+    long swaps_accepted;
+
+    BasicParallelTempering(const GridInstance& grid_inst, const std::vector<std::pair<int, int>>& initial_path,
+                           int num_replicas, unsigned seed);
+
+    void build_ladder(); // temperatures of the replicas from the uphill deltas at Current_sol
+
+    void run(int num_exchanges, int steps_per_exchange, bool print_progress = false);
+
+private:
+    bool exchange(int lower); // Metropolis swap between replicas lower and lower + 1
+};
+
+typedef BasicParallelTempering<EuclideanCost, EightConnected> ParallelTempering;
+
+// Instantiated in tempering.cpp
+extern template class BasicParallelTempering<EuclideanCost, EightConnected>;
+extern template class BasicParallelTempering<EuclideanCost, FourConnected>;
+extern template class BasicParallelTempering<ManhattanCost, EightConnected>;
+extern template class BasicParallelTempering<ManhattanCost, FourConnected>;
+extern template class BasicParallelTempering<ClearanceCost, EightConnected>;
+extern template class BasicParallelTempering<ClearanceCost, FourConnected>;
+extern template class BasicParallelTempering<TurnPenaltyCost, EightConnected>;
+extern template class BasicParallelTempering<TurnPenaltyCost, FourConnected>;
+
+#endif // TEMPERING_H
@@ -0,0 +1,661 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <cstdlib>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include "query.h"
+#include "generator.h"
+#include "chain.h"
+#include "multi_agent.h"
+#include "instance.h"
+#include "results.h"
+
+//Pruebas de make test: cada CHECK que falla se reporta con su linea y el programa termina con 1
+int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            failures++; \
+        } \
+    } while (0)
+
+//Lector minimo de JSON, solo para validar las lineas que escriben query.cpp y main. Guarda los
+// strings del objeto de primer nivel (ya decodificados) en strings
+class JsonReader {
+public:
+    explicit JsonReader(const std::string& text) : text_(text), pos_(0) {}
+
+    bool parse(std::map<std::string, std::string>& strings) {
+        skip_space();
+        if (!object(&strings)) return false;
+        skip_space();
+        return pos_ == text_.size();
+    }
+
+private:
+    bool value(std::map<std::string, std::string>* strings, const std::string& key) {
+        skip_space();
+        if (pos_ >= text_.size()) return false;
+        char c = text_[pos_];
+        if (c == '{') return object(nullptr);
+        if (c == '[') return array();
+        if (c == '"') {
+            std::string decoded;
+            if (!string(decoded)) return false;
+            if (strings) (*strings)[key] = decoded;
+            return true;
+        }
+        if (text_.compare(pos_, 4, "true") == 0 || text_.compare(pos_, 4, "null") == 0) {
+            pos_ += 4;
+            return true;
+        }
+        if (text_.compare(pos_, 5, "false") == 0) {
+            pos_ += 5;
+            return true;
+        }
+        return number();
+    }
+    bool object(std::map<std::string, std::string>* strings) {
+        pos_++; // {
+        skip_space();
+        if (pos_ < text_.size() && text_[pos_] == '}') return ++pos_, true;
+        for (;;) {
+            skip_space();
+            std::string key;
+            if (pos_ >= text_.size() || text_[pos_] != '"' || !string(key)) return false;
+            skip_space();
+            if (pos_ >= text_.size() || text_[pos_++] != ':') return false;
+            if (!value(strings, key)) return false;
+            skip_space();
+            if (pos_ >= text_.size()) return false;
+            if (text_[pos_] == '}') return ++pos_, true;
+            if (text_[pos_++] != ',') return false;
+        }
+    }
+    bool array() {
+        pos_++; // [
+        skip_space();
+        if (pos_ < text_.size() && text_[pos_] == ']') return ++pos_, true;
+        for (;;) {
+            if (!value(nullptr, "")) return false;
+            skip_space();
+            if (pos_ >= text_.size()) return false;
+            if (text_[pos_] == ']') return ++pos_, true;
+            if (text_[pos_++] != ',') return false;
+        }
+    }
+    bool string(std::string& decoded) {
+        pos_++; // "
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"') return true;
+            if ((unsigned char) c < 0x20) return false; // raw control characters are not allowed
+            if (c != '\\') {
+                decoded += c;
+                continue;
+            }
+            if (pos_ >= text_.size()) return false;
+            char e = text_[pos_++];
+            switch (e) {
+                case '"': case '\\': case '/': decoded += e; break;
+                case 'b': decoded += '\b'; break;
+                case 'f': decoded += '\f'; break;
+                case 'n': decoded += '\n'; break;
+                case 'r': decoded += '\r'; break;
+                case 't': decoded += '\t'; break;
+                case 'u': {
+                    if (pos_ + 4 > text_.size()) return false;
+                    unsigned code = (unsigned) std::strtoul(text_.substr(pos_, 4).c_str(), nullptr, 16);
+                    pos_ += 4;
+                    decoded += (char) code; // only the control characters of json_escape are expected
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+    bool number() {
+        size_t start = pos_;
+        if (pos_ < text_.size() && text_[pos_] == '-') pos_++;
+        while (pos_ < text_.size() && (std::isdigit((unsigned char) text_[pos_]) || text_[pos_] == '.' ||
+                                       text_[pos_] == 'e' || text_[pos_] == 'E' || text_[pos_] == '+' || text_[pos_] == '-')) {
+            pos_++;
+        }
+        return pos_ > start && std::isdigit((unsigned char) text_[pos_ - 1]);
+    }
+    void skip_space() {
+        while (pos_ < text_.size() && std::isspace((unsigned char) text_[pos_])) pos_++;
+    }
+
+    const std::string& text_;
+    size_t pos_;
+};
+
+//Una linea mal formada con comillas, barras invertidas o caracteres de control tiene que dar
+// una respuesta de error que sea JSON valido y que repita el texto tal cual
+void test_query_error_escaping() {
+    const char* lines[] = {"0 0 1 1 5 10 \"oops\\", "0 0 1 1 5 10 a\"b\\\\c", "0 0 1 1 5 10 x\x01" "y"};
+    for (const char* line : lines) {
+        RouteQuery query;
+        CHECK(parse_query(line, 1, query));
+        CHECK(!query.error.empty());
+        RouteAnswer answer;
+        answer.error = query.error;
+        std::ostringstream out;
+        write_answer(out, query, answer);
+
+        std::string written = out.str();
+        CHECK(!written.empty() && written.back() == '\n');
+        written.pop_back();
+        std::map<std::string, std::string> strings;
+        CHECK(JsonReader(written).parse(strings));
+        CHECK(strings["status"] == "error");
+        CHECK(strings["error"] == query.error);
+    }
+}
+
+//Mascaras y tabla de holgura iguales a las de un grid construido de cero, en todas las celdas
+bool masks_equal_rebuild(const NeighborMasks& masks, const OccupancyGrid& grid) {
+    NeighborMasks fresh = NeighborMasks::build(grid);
+    for (int y = 0; y < grid.rows(); ++y) {
+        for (int x = 0; x < grid.cols(); ++x) {
+            if (masks.free_mask(grid.index(x, y)) != fresh.free_mask(grid.index(x, y))) return false;
+        }
+    }
+    return true;
+}
+
+bool clearance_equal_rebuild(const ClearanceCost& cost, const OccupancyGrid& grid) {
+    ClearanceCost fresh;
+    fresh.radius = cost.radius;
+    fresh.prepare(grid);
+    for (int y = 0; y < grid.rows(); ++y) {
+        for (int x = 0; x < grid.cols(); ++x) {
+            if (cost.penalty({x, y}) != fresh.penalty({x, y})) return false;
+        }
+    }
+    return true;
+}
+
+//Las mascaras y la tabla de ClearanceCost de un grid no se reusan con otro grid del mismo tamano,
+// y si con las copias del mismo grid
+void test_caches_follow_the_grid() {
+    GridInstance first = generate_instance(INSTANCE_RANDOM, 64, 64, 1);
+    GridInstance second = generate_instance(INSTANCE_RANDOM, 64, 64, 2);
+    first.masks = NeighborMasks::build(first.grid);
+    second.masks = first.masks; // same size, other obstacles
+
+    GridInstance copy = first;
+    CHECK(copy.masks.matches(copy.grid));
+    CHECK(!second.masks.matches(second.grid));
+
+    BasicSimulatedAnnealing<ClearanceCost, EightConnected> sa(1.0, 0.9, 0.1, first, std::vector<std::pair<int, int>>());
+    CHECK(clearance_equal_rebuild(sa.cost_policy, first.grid));
+    sa.init(1.0, 0.9, 0.1, second); // the same annealer reused on the other map
+    CHECK(masks_equal_rebuild(sa.grid_instance.masks, second.grid));
+    CHECK(clearance_equal_rebuild(sa.cost_policy, second.grid));
+
+    // a changed copy gets its own storage, the original keeps its masks
+    copy.grid.set_blocked(10, 10, !copy.grid.blocked(10, 10));
+    CHECK(!copy.masks.matches(copy.grid));
+    CHECK(first.masks.matches(first.grid));
+}
+
+//Con todas las politicas y todos los tipos de movimiento, el costo que step() lleva con los deltas
+// tiene que ser el costo del camino recalculado, y cada delta la diferencia de los costos completos
+bool near(double a, double b) {
+    return std::fabs(a - b) <= 1e-6 * std::max(1.0, std::fabs(b));
+}
+
+template <class Annealer>
+void check_no_cost_drift(const GridInstance& instance, unsigned seed) {
+    SearchContext context;
+    std::vector<std::pair<int, int>> seed_path; // long winding DFS seed, every move type has something to do
+    CHECK(find_path(instance.grid, instance.start, instance.end, SEED_DFS, context, seed_path,
+                    Annealer::ConnectivityPolicy::DEGREE));
+    Annealer sa(1.0, 0.9, 0.1, instance, seed_path);
+    sa.set_random_seed(seed);
+    for (int t = 0; t < NUM_MOVE_TYPES; ++t) sa.move_weights[t] = 1.0;
+    sa.prepare_run();
+    CHECK(sa.is_valid_path(sa.Current_sol));
+    sa.T = 2.0; // uphill moves are accepted too
+
+    for (int s = 0; s < 4000; ++s) {
+        sa.batch_size = (s / 500) % 2 ? 8 : 1;
+        sa.step();
+    }
+    CHECK(sa.is_valid_path(sa.Current_sol));
+    CHECK(near(sa.current_cost, sa.evaluate_cost(sa.Current_sol)));
+    CHECK(near(sa.best_cost, sa.evaluate_cost(sa.Best_sol)));
+
+    for (int s = 0; s < 400; ++s) {
+        MoveType type = (MoveType)(s % NUM_MOVE_TYPES);
+        Move move = type == MOVE_SHIFT ? sa.propose_move(sa.Current_sol) : sa.propose_shortening(type);
+        if (move.index < 0 || !sa.is_valid_move(sa.Current_sol, move)) continue;
+        std::vector<std::pair<int, int>> before = sa.Current_sol;
+        double cost_before = sa.evaluate_cost(before);
+        double delta = sa.evaluate_delta(sa.Current_sol, move);
+        sa.apply_move(move);
+        CHECK(sa.is_valid_path(sa.Current_sol));
+        CHECK(near(cost_before + delta, sa.evaluate_cost(sa.Current_sol)));
+        sa.revert_move(move);
+        CHECK(sa.Current_sol == before);
+    }
+}
+
+template <class Cost>
+void check_no_cost_drift_both(const GridInstance& instance, unsigned seed) {
+    check_no_cost_drift<BasicSimulatedAnnealing<Cost, EightConnected>>(instance, seed);
+    check_no_cost_drift<BasicSimulatedAnnealing<Cost, FourConnected>>(instance, seed);
+}
+
+void test_incremental_costs() {
+    const InstanceKind kinds[] = {INSTANCE_BLOCKS, INSTANCE_MAZE}; // 4-connected paths on both
+    for (InstanceKind kind : kinds) {
+        GridInstance instance = generate_instance(kind, 41, 41, 3);
+        check_no_cost_drift_both<EuclideanCost>(instance, 7);
+        check_no_cost_drift_both<ManhattanCost>(instance, 7);
+        check_no_cost_drift_both<ClearanceCost>(instance, 7);
+        check_no_cost_drift_both<TurnPenaltyCost>(instance, 7);
+    }
+}
+
+//JPS da caminos validos y del mismo costo que A* en todos los tipos de instancia
+bool valid_grid_path(const OccupancyGrid& grid, const std::vector<std::pair<int, int>>& path,
+                     const std::pair<int, int>& start, const std::pair<int, int>& end) {
+    if (path.empty() || path.front() != start || path.back() != end) return false;
+    for (size_t k = 0; k < path.size(); ++k) {
+        if (!grid.in_bounds(path[k].first, path[k].second) || grid.blocked(path[k].first, path[k].second)) return false;
+        if (k && !EightConnected::adjacent(path[k - 1], path[k])) return false;
+    }
+    return true;
+}
+
+double octile_length(const std::vector<std::pair<int, int>>& path) {
+    double length = 0.0;
+    for (size_t k = 1; k < path.size(); ++k) length += EuclideanCost::length(path[k - 1], path[k]);
+    return length;
+}
+
+void test_jps_matches_astar() {
+    SearchContext context;
+    std::vector<std::pair<int, int>> astar, jps;
+    for (int kind = 0; kind < NUM_INSTANCE_KINDS; ++kind) {
+        for (unsigned seed = 1; seed <= 4; ++seed) {
+            GridInstance instance = generate_instance((InstanceKind) kind, 60, 80, seed);
+            bool found = find_path(instance.grid, instance.start, instance.end, SEED_ASTAR, context, astar);
+            CHECK(found == find_path(instance.grid, instance.start, instance.end, SEED_JPS, context, jps));
+            if (!found) continue;
+            CHECK(valid_grid_path(instance.grid, jps, instance.start, instance.end));
+            CHECK(near(octile_length(jps), octile_length(astar)));
+
+            // a free cell in the middle of the map as another end, reachable or not
+            std::pair<int, int> middle(40, 30);
+            while (instance.grid.blocked(middle.first, middle.second)) middle.first++;
+            found = find_path(instance.grid, instance.start, middle, SEED_ASTAR, context, astar);
+            CHECK(found == find_path(instance.grid, instance.start, middle, SEED_JPS, context, jps));
+            if (found) {
+                CHECK(valid_grid_path(instance.grid, jps, instance.start, middle));
+                CHECK(near(octile_length(jps), octile_length(astar)));
+            }
+        }
+    }
+}
+
+//ChainPath: codificar y decodificar devuelve el camino sin los puntos repetidos, point(i) y
+// direction(k) lo recorren igual a traves de varios checkpoints, y un salto no se codifica
+void test_chain_round_trip() {
+    GridInstance instance = generate_instance(INSTANCE_BLOCKS, 64, 64, 5);
+    std::mt19937 rng(11);
+    std::vector<std::pair<int, int>> walk(1, std::make_pair(32, 32)), kept(walk), decoded;
+    while (walk.size() < 3 * ChainPath::CHECKPOINT_INTERVAL + 17) { // random walk in the grid, with waits
+        int d = rng() % 9;
+        std::pair<int, int> p = walk.back();
+        if (d < 8) {
+            p.first = std::min(63, std::max(0, p.first + NEIGHBOR_OFFSETS[d][0]));
+            p.second = std::min(63, std::max(0, p.second + NEIGHBOR_OFFSETS[d][1]));
+        }
+        walk.push_back(p);
+        if (p != kept.back()) kept.push_back(p);
+    }
+
+    ChainPath chain;
+    CHECK(chain.encode(walk));
+    CHECK(chain.size() == kept.size());
+    CHECK(chain.steps() + 1 == kept.size());
+    chain.decode(decoded);
+    CHECK(decoded == kept);
+    CHECK(chain.front() == kept.front() && chain.back() == kept.back());
+    CHECK(near(chain.euclidean_length(), octile_length(kept)));
+    CHECK(near(chain.cost(EuclideanCost()), octile_length(kept)));
+    for (size_t i = 0; i < kept.size(); ++i) {
+        CHECK(chain.point(i) == kept[i]);
+        if (i + 1 < kept.size()) {
+            int d = chain.direction(i);
+            CHECK(kept[i].first + NEIGHBOR_OFFSETS[d][0] == kept[i + 1].first);
+            CHECK(kept[i].second + NEIGHBOR_OFFSETS[d][1] == kept[i + 1].second);
+        }
+    }
+    bool free = true;
+    for (const auto& p : kept) free = free && !instance.grid.blocked(p.first, p.second);
+    CHECK(chain.is_free(instance.grid) == free);
+
+    ChainPath pushed; // built step by step like the query answers
+    pushed.start_at(kept.front());
+    for (size_t k = 0; k < chain.steps(); ++k) pushed.push_back(chain.direction(k));
+    pushed.decode(decoded);
+    CHECK(decoded == kept);
+
+    walk.push_back(std::make_pair(walk.back().first + 2, walk.back().second)); // not a neighbour
+    CHECK(!chain.encode(walk));
+    CHECK(chain.empty() && chain.size() == 0);
+}
+
+//Tabla de reservas: conteos y ultimo agente por celda y por arista, una espera no usa arista
+void test_reservation_table() {
+    ReservationTable table(66); // stride of a 64 column grid
+    std::pair<int, int> a(3, 4), b(4, 4), c(4, 5);
+    table.add(a, 2, 0);
+    table.add(a, 2, 1);
+    CHECK(table.at(a, 2) == 2 && table.occupant(a, 2) == 1);
+    CHECK(table.at(a, 3) == 0 && table.at(b, 2) == 0 && table.occupant(a, 3) == -1);
+    table.remove(a, 2);
+    CHECK(table.at(a, 2) == 1);
+    table.remove(a, 2);
+    CHECK(table.at(a, 2) == 0 && table.occupant(a, 2) == -1 && table.size() == 0);
+
+    table.add_edge(a, b, 5, 7);
+    table.add_edge(b, c, 5, 8);
+    table.add_edge(a, a, 5, 9); // a wait
+    CHECK(table.crossing(a, b, 5) == 1 && table.crosser(a, b, 5) == 7);
+    CHECK(table.crossing(b, a, 5) == 0 && table.crossing(a, b, 6) == 0 && table.crossing(a, a, 5) == 0);
+    CHECK(table.crosser(b, c, 5) == 8 && table.size() == 2);
+    table.remove_edge(a, b, 5);
+    table.remove_edge(a, a, 5);
+    CHECK(table.crossing(a, b, 5) == 0 && table.crosser(a, b, 5) == -1 && table.size() == 1);
+    table.clear();
+    CHECK(table.size() == 0);
+}
+
+//Conflictos contados a fuerza bruta: pares de agentes en la misma celda al mismo tiempo, o que
+// cambian de lugar entre t y t + 1
+template <class Planner>
+long brute_force_conflicts(const Planner& planner) {
+    long total = 0;
+    for (size_t a = 0; a < planner.agents.size(); ++a) {
+        for (size_t b = 0; b < a; ++b) {
+            if (!planner.agents[a] || !planner.agents[b]) continue;
+            const std::vector<std::pair<int, int>>& pa = planner.agents[a]->Current_sol;
+            const std::vector<std::pair<int, int>>& pb = planner.agents[b]->Current_sol;
+            for (size_t t = 0; t < pa.size(); ++t) {
+                if (pa[t] == pb[t]) total++;
+                if (t + 1 < pa.size() && pa[t] != pa[t + 1] && pa[t] == pb[t + 1] && pa[t + 1] == pb[t]) total++;
+            }
+        }
+    }
+    return total;
+}
+
+//Agentes que se cruzan en un mapa con edificios: caminos validos en el tiempo (un paso o una espera),
+// todos del horizonte, el conteo de conflictos igual al de fuerza bruta, y sin conflictos al final
+void test_multi_agent_plan() {
+    GridInstance instance = generate_instance(INSTANCE_BLOCKS, 32, 32, 4);
+    std::vector<MultiAgentAnnealing::Endpoints> endpoints;
+    const std::pair<int, int> corners[] = {{0, 0}, {31, 31}, {31, 0}, {0, 31}, {15, 0}, {15, 31}, {0, 15}, {31, 15}};
+    for (int k = 0; k < 8; ++k) { // each agent to the opposite side, every path goes through the middle
+        std::pair<int, int> start = corners[k], end = corners[k ^ 1];
+        while (instance.grid.blocked(start.first, start.second)) start.second += start.second ? -1 : 1;
+        while (instance.grid.blocked(end.first, end.second)) end.second += end.second ? -1 : 1;
+        endpoints.push_back(std::make_pair(start, end));
+    }
+
+    MultiAgentAnnealing planner(instance);
+    planner.num_threads = 2;
+    CHECK(planner.plan(endpoints));
+    CHECK(planner.conflicts == 0);
+    CHECK(planner.count_conflicts() == brute_force_conflicts(planner));
+    CHECK(!planner.round_stats.empty()); // the seeds cross, at least one round was needed
+    for (size_t k = 0; k < planner.agents.size(); ++k) {
+        if (!planner.agents[k]) continue;
+        const std::vector<std::pair<int, int>>& path = planner.agents[k]->Current_sol;
+        CHECK((int) path.size() == planner.horizon);
+        CHECK(path.front() == endpoints[k].first);
+        for (size_t t = 0; t < path.size(); ++t) {
+            CHECK(!instance.grid.blocked(path[t].first, path[t].second));
+            if (t) CHECK(path[t] == path[t - 1] || EightConnected::adjacent(path[t - 1], path[t]));
+        }
+        for (int t = planner.arrival(k); t < planner.horizon; ++t) CHECK(path[t] == endpoints[k].second);
+    }
+
+    // two agents in the same cell at the same time and a swap are both counted
+    planner.agents[1]->Current_sol = planner.agents[0]->Current_sol;
+    std::pair<int, int> p(16, 16), q(17, 16);
+    while (instance.grid.blocked(p.first, p.second) || instance.grid.blocked(q.first, q.second)) q.second = ++p.second;
+    for (int t = 0; t < planner.horizon; ++t) { // valid paths, the table only knows neighbour steps
+        planner.agents[2]->Current_sol[t] = t <= 4 ? p : q;
+        planner.agents[3]->Current_sol[t] = t <= 4 ? q : p;
+    }
+    CHECK(planner.count_conflicts() > 0);
+    CHECK(planner.count_conflicts() == brute_force_conflicts(planner));
+}
+
+//update_cells: tras cada lote de celdas bloqueadas (varias sobre el camino) y liberadas, los caminos
+// reparados son validos, los costos son los recalculados, las mascaras y la tabla de holgura son las
+// de un grid nuevo, y la instancia original (compartida) no cambia
+template <class Cost>
+bool cost_equal_rebuild(const Cost&, const OccupancyGrid&) { return true; } // nothing cached
+
+bool cost_equal_rebuild(const ClearanceCost& cost, const OccupancyGrid& grid) {
+    return clearance_equal_rebuild(cost, grid);
+}
+
+template <class Annealer>
+void check_update_cells(const GridInstance& instance, unsigned seed) {
+    SearchContext context;
+    std::vector<std::pair<int, int>> seed_path;
+    CHECK(find_path(instance.grid, instance.start, instance.end, SEED_ASTAR, context, seed_path,
+                    Annealer::ConnectivityPolicy::DEGREE));
+    Annealer sa(1.0, 0.9, 0.1, instance, seed_path);
+    sa.set_random_seed(seed);
+    for (int t = 0; t < NUM_MOVE_TYPES; ++t) sa.move_weights[t] = 1.0;
+    sa.prepare_run();
+    OccupancyGrid original = instance.grid;
+
+    std::mt19937 rng(seed);
+    for (int round = 0; round < 30; ++round) {
+        for (int s = 0; s < 300; ++s) sa.step(); // Current_sol and Best_sol drift apart
+        std::vector<CellChange> changes;
+        for (int k = 0; k < 3; ++k) { // cut the current path, never at its ends
+            const std::pair<int, int>& p = sa.Current_sol[1 + rng() % (sa.Current_sol.size() - 2)];
+            changes.push_back(CellChange{p.first, p.second, true});
+        }
+        for (int k = 0; k < 6; ++k) {
+            int x = rng() % instance.cols, y = rng() % instance.rows;
+            std::pair<int, int> p(x, y);
+            if (p == instance.start || p == instance.end) continue;
+            changes.push_back(CellChange{x, y, k % 2 == 0});
+        }
+        if (!sa.update_cells(changes)) { // only if the end can no longer be reached
+            const OccupancyGrid& grid = sa.grid_instance.grid;
+            CHECK(grid.blocked(instance.end.first, instance.end.second) ||
+                  !find_path(grid, instance.start, instance.end, SEED_ASTAR, context, seed_path,
+                             Annealer::ConnectivityPolicy::DEGREE));
+            break;
+        }
+        CHECK(sa.is_valid_path(sa.Current_sol));
+        CHECK(sa.is_valid_path(sa.Best_sol));
+        CHECK(near(sa.current_cost, sa.evaluate_cost(sa.Current_sol)));
+        CHECK(near(sa.best_cost, sa.evaluate_cost(sa.Best_sol)));
+        CHECK(sa.best_cost <= sa.current_cost);
+        CHECK(sa.grid_instance.masks.matches(sa.grid_instance.grid));
+        CHECK(masks_equal_rebuild(sa.grid_instance.masks, sa.grid_instance.grid));
+        CHECK(cost_equal_rebuild(sa.cost_policy, sa.grid_instance.grid));
+
+        if (round % 10 == 5) { // the annealing goes on from the repaired state
+            RunLimits limits;
+            limits.max_iterations = 2000;
+            sa.run_warm(limits);
+            CHECK(sa.is_valid_path(sa.Best_sol));
+            CHECK(near(sa.best_cost, sa.evaluate_cost(sa.Best_sol)));
+        }
+    }
+    bool unchanged = true; // the annealer copied the shared grid before its first change
+    for (int y = 0; y < original.rows(); ++y) {
+        for (int x = 0; x < original.cols(); ++x) unchanged = unchanged && instance.grid.blocked(x, y) == original.blocked(x, y);
+    }
+    CHECK(unchanged);
+    CHECK(instance.masks.matches(instance.grid));
+}
+
+void test_update_cells() {
+    GridInstance instance = generate_instance(INSTANCE_BLOCKS, 64, 64, 6);
+    instance.masks = NeighborMasks::build(instance.grid); // shared with the annealers, like InstanceCache
+    check_update_cells<BasicSimulatedAnnealing<EuclideanCost, EightConnected>>(instance, 1);
+    check_update_cells<BasicSimulatedAnnealing<ClearanceCost, EightConnected>>(instance, 2);
+    check_update_cells<BasicSimulatedAnnealing<ClearanceCost, FourConnected>>(instance, 3);
+    check_update_cells<BasicSimulatedAnnealing<TurnPenaltyCost, FourConnected>>(instance, 4);
+}
+
+//Un archivo binario con un hueco en el borde de obstaculos se rechaza, el original se carga
+void test_binary_border() {
+    GridInstance instance = generate_instance(INSTANCE_BLOCKS, 5, 7, 1);
+    const char* path = "sa_tests_border.bin";
+    CHECK(write_binary_instance(path, instance));
+    GridInstance loaded;
+    CHECK(load_binary_instance(path, loaded));
+
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    size_t cell = instance.grid.index(instance.cols, 2); // right border, third row
+    char byte = 0;
+    file.seekg(40 + cell / 8); // after the header, LSB first
+    file.read(&byte, 1);
+    byte &= (char) ~(1 << (cell % 8));
+    file.seekp(40 + cell / 8);
+    file.write(&byte, 1);
+    file.close();
+    CHECK(!load_binary_instance(path, loaded));
+    std::remove(path);
+}
+
+//Con shortening_window menor que 2 los movimientos de acortamiento no aplican, sin dividir por cero
+// ni salirse del camino
+void test_short_shortening_window() {
+    GridInstance instance = generate_instance(INSTANCE_BLOCKS, 32, 32, 8);
+    SearchContext context;
+    std::vector<std::pair<int, int>> seed_path;
+    CHECK(find_path(instance.grid, instance.start, instance.end, SEED_DFS, context, seed_path));
+    for (int window = -1; window <= 2; ++window) {
+        SimulatedAnnealing sa(1.0, 0.9, 0.1, instance, seed_path);
+        sa.set_random_seed(5);
+        for (int t = 0; t < NUM_MOVE_TYPES; ++t) sa.move_weights[t] = 1.0;
+        sa.shortening_window = window;
+        sa.prepare_run();
+        for (int s = 0; s < 2000; ++s) {
+            if (window < 2) {
+                CHECK(sa.propose_shortening(MOVE_SPLICE_LOOP).index < 0);
+                CHECK(sa.propose_shortening(MOVE_SHORTCUT).index < 0);
+            }
+            sa.step();
+        }
+        CHECK(sa.is_valid_path(sa.Current_sol));
+        CHECK(near(sa.current_cost, sa.evaluate_cost(sa.Current_sol)));
+    }
+}
+
+//Con pocos conflictos las llegadas planeadas quedan cerca de las de los caminos iniciales: esperar
+// antes de llegar cuesta arrival_weight por paso, sin eso las esperas se corren hasta el horizonte
+void test_multi_agent_arrivals() {
+    for (unsigned seed = 1; seed <= 2; ++seed) {
+        GridInstance instance = generate_instance(INSTANCE_BLOCKS, 40, 40, seed);
+        std::vector<MultiAgentAnnealing::Endpoints> endpoints;
+        const std::pair<int, int> corners[] = {{0, 0}, {39, 39}, {39, 0}, {0, 39}};
+        for (int k = 0; k < 4; ++k) { // corner to corner, the paths cross once or twice
+            std::pair<int, int> start = corners[k], end = corners[k ^ 1];
+            while (instance.grid.blocked(start.first, start.second)) start.second += start.second ? -1 : 1;
+            while (instance.grid.blocked(end.first, end.second)) end.second += end.second ? -1 : 1;
+            endpoints.push_back(std::make_pair(start, end));
+        }
+        SearchContext context;
+        std::vector<std::pair<int, int>> seed_path;
+        int seed_arrivals = 0;
+        for (const auto& endpoint : endpoints) {
+            CHECK(find_path(instance.grid, endpoint.first, endpoint.second, SEED_ASTAR, context, seed_path));
+            seed_arrivals += (int) seed_path.size() - 1;
+        }
+
+        MultiAgentAnnealing planner(instance);
+        planner.num_threads = 2;
+        CHECK(planner.plan(endpoints));
+        CHECK(planner.conflicts == 0);
+        CHECK(!planner.round_stats.empty() && planner.round_stats[0].conflicts_before <= 2);
+        int arrivals = 0;
+        for (size_t k = 0; k < endpoints.size(); ++k) arrivals += planner.arrival(k);
+        CHECK(arrivals - seed_arrivals <= 2 * (int) endpoints.size()); // without the term half of them arrive 12 to 15 steps late
+    }
+}
+
+//Retomar un archivo de corridas corta solo la linea incompleta del final y agrega detras de las filas
+// terminadas, sin reescribirlas
+void test_results_resume() {
+    const char* path = "sa_tests_runs.csv";
+    // rows of an earlier sweep, in a format write_record would not produce so a rewrite shows
+    std::string kept = std::string(ResultsWriter::header()) + "\n" +
+                       "prob_a,0,7,10,8,100,1.5,exponential,0.01,0\n" +
+                       "prob_a,1,7,10,8,100,1.5,exponential,0.01,0\n";
+    {
+        std::ofstream out(path);
+        out << kept << "prob_a,2,7,10.0"; // and a run cut by the interruption
+    }
+    RunRecord record = {"prob_a", 2, 7, 10.0, 8.0, 100, 1.5, "exponential", 0.01, 0};
+
+    ResultsWriter writer(path, true);
+    CHECK(writer.is_open());
+    CHECK(writer.resumed() == 2);
+    RunRecord previous;
+    CHECK(writer.completed("prob_a", "exponential", 1, previous) && previous.seed == 7);
+    CHECK(!writer.completed("prob_a", "exponential", 2, previous));
+    writer.push(record);
+    writer.close();
+    CHECK(writer.summaries().at(SummaryKey("prob_a", "exponential")).best_cost.count() == 3);
+
+    std::ifstream in(path);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    CHECK(content.compare(0, kept.size(), kept) == 0);
+    CHECK(content.find("prob_a,2,7,10.0\n") == std::string::npos);
+    CHECK(std::count(content.begin(), content.end(), '\n') == 4); // header and three runs
+    in.close();
+    std::remove(path);
+}
+
+int main() {
+    test_query_error_escaping();
+    test_caches_follow_the_grid();
+    test_incremental_costs();
+    test_short_shortening_window();
+    test_jps_matches_astar();
+    test_chain_round_trip();
+    test_reservation_table();
+    test_multi_agent_plan();
+    test_multi_agent_arrivals();
+    test_update_cells();
+    test_binary_border();
+    test_results_resume();
+
+    if (failures) {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All tests passed" << std::endl;
+    return 0;
+}